@@ -0,0 +1,159 @@
+#ifndef HARA_BENCH_BENCHMARK_H
+#define HARA_BENCH_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace hara {
+namespace bench {
+
+/**
+ * Summary of the timed repetitions of a single benchmark
+ */
+struct Result {
+    std::string name;
+    size_t repetitions;
+    // work units processed by one run, e.g. lines or operations
+    size_t items;
+    std::string unit;
+    double min_ns;
+    double median_ns;
+    double p99_ns;
+
+    double ItemsPerSec() const { return median_ns > 0 ? items * 1e9 / median_ns : 0; }
+};
+
+/**
+ * Untimed figure reported alongside the benchmarks, e.g. memory per key
+ */
+struct Metric {
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+/**
+ * Minimal benchmark runner
+ * Every benchmark is a function performing one full run and returning a checksum,
+ * which is accumulated so the compiler cannot drop the work
+ */
+class Runner {
+public:
+    using Function = std::function<size_t()>;
+
+    Runner(size_t warmup, size_t repetitions, std::string filter)
+            : warmup{warmup}, repetitions{std::max<size_t>(1, repetitions)},
+              filter{std::move(filter)}, checksum{0} {}
+
+    /**
+     * Run the benchmark unless filtered out
+     * @param items work units processed by one call of fn
+     */
+    void Run(const std::string &name, size_t items, const std::string &unit, const Function &fn) {
+        Run(name, unit, [items]() { return items; }, fn);
+    }
+
+    /**
+     * Run the benchmark unless filtered out, after an untimed setup
+     * @param setup builds what fn needs, typically through Lazy values shared with other benchmarks,
+     *        and returns the work units processed by one call of fn
+     */
+    void Run(const std::string &name, const std::string &unit, const std::function<size_t()> &setup,
+             const Function &fn) {
+        if (!Selected(name)) return;
+        const auto items = setup();
+
+        for (size_t i = 0; i < warmup; ++i) checksum += fn();
+
+        std::vector<double> samples;
+        samples.reserve(repetitions);
+        for (size_t i = 0; i < repetitions; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            checksum += fn();
+            auto end = std::chrono::steady_clock::now();
+            samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+        std::sort(samples.begin(), samples.end());
+
+        Result result{name, repetitions, items, unit, samples.front(),
+                      Percentile(samples, 50), Percentile(samples, 99)};
+        std::cerr << std::left << std::setw(40) << name << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(3) << result.median_ns / 1e6 << " ms"
+                  << std::setw(12) << result.p99_ns / 1e6 << " ms (p99)"
+                  << std::setw(14) << std::setprecision(0) << result.ItemsPerSec() << ' ' << unit << "/s"
+                  << '\n';
+        results.push_back(std::move(result));
+    }
+
+    /**
+     * Report an untimed figure unless filtered out
+     * @param measure computes the value, building whatever it needs only when selected
+     */
+    void Report(const std::string &name, const std::string &unit, const std::function<double()> &measure) {
+        if (!Selected(name)) return;
+        Metric metric{name, measure(), unit};
+        std::cerr << std::left << std::setw(40) << name << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(1) << metric.value << ' ' << unit << '\n';
+        metrics.push_back(std::move(metric));
+    }
+
+    bool Selected(const std::string &name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    /**
+     * Machine-readable report of every result and metric so far
+     */
+    void WriteJson(std::ostream &os, unsigned seed, size_t scale) const {
+        os << "{\n  \"seed\": " << seed << ",\n  \"scale\": " << scale
+           << ",\n  \"checksum\": " << checksum << ",\n  \"benchmarks\": [";
+        for (size_t idx = 0; idx < results.size(); ++idx) {
+            const auto &r = results[idx];
+            os << (idx ? "," : "") << "\n    {\"name\": \"" << r.name << "\""
+               << ", \"repetitions\": " << r.repetitions
+               << ", \"items\": " << r.items
+               << ", \"unit\": \"" << r.unit << "\""
+               << std::fixed << std::setprecision(0)
+               << ", \"min_ns\": " << r.min_ns
+               << ", \"median_ns\": " << r.median_ns
+               << ", \"p99_ns\": " << r.p99_ns
+               << std::setprecision(2)
+               << ", \"items_per_sec\": " << r.ItemsPerSec() << "}";
+        }
+        os << "\n  ],\n  \"metrics\": [";
+        for (size_t idx = 0; idx < metrics.size(); ++idx) {
+            const auto &m = metrics[idx];
+            os << (idx ? "," : "") << "\n    {\"name\": \"" << m.name << "\""
+               << std::fixed << std::setprecision(2)
+               << ", \"value\": " << m.value
+               << ", \"unit\": \"" << m.unit << "\"}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+private:
+    /**
+     * nearest-rank percentile of sorted samples
+     */
+    static double Percentile(const std::vector<double> &sorted, size_t percent) {
+        auto rank = (percent * sorted.size() + 99) / 100;
+        return sorted[std::max<size_t>(1, rank) - 1];
+    }
+
+    const size_t warmup;
+    const size_t repetitions;
+    const std::string filter;
+    size_t checksum;
+    std::vector<Result> results;
+    std::vector<Metric> metrics;
+};
+
+}
+}
+
+#endif //HARA_BENCH_BENCHMARK_H
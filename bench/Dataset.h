@@ -0,0 +1,96 @@
+#ifndef HARA_BENCH_DATASET_H
+#define HARA_BENCH_DATASET_H
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace hara {
+namespace bench {
+
+/**
+ * Reproducible data generation
+ * Only std::mt19937 output is used directly, since it is fully specified by the standard
+ * while the std distributions differ between library implementations
+ */
+class Dataset {
+public:
+    explicit Dataset(unsigned seed) : gen{seed} {}
+
+    /**
+     * uniform in [0, n)
+     */
+    size_t Uniform(size_t n) { return static_cast<size_t>(gen() % n); }
+
+    /**
+     * unique lowercase words of length [min_length, max_length]
+     */
+    std::vector<std::string> Vocabulary(size_t size, size_t min_length = 2, size_t max_length = 10) {
+        std::set<std::string> seen;
+        std::vector<std::string> words;
+        words.reserve(size);
+        while (words.size() < size) {
+            std::string word(min_length + Uniform(max_length - min_length + 1), 'a');
+            for (auto &c : word) c = static_cast<char>('a' + Uniform(26));
+            if (seen.insert(word).second) words.push_back(std::move(word));
+        }
+        return words;
+    }
+
+    /**
+     * lines of space-separated words drawn from vocab with a Zipf(1) distribution
+     */
+    std::vector<std::string> Corpus(const std::vector<std::string> &vocab, size_t num_lines, size_t words_per_line) {
+        std::vector<double> cdf(vocab.size());
+        double total = 0;
+        for (size_t rank = 0; rank < vocab.size(); ++rank) cdf[rank] = total += 1. / (rank + 1);
+
+        std::vector<std::string> lines(num_lines);
+        for (auto &line : lines) {
+            for (size_t i = 0; i < words_per_line; ++i) {
+                const auto u = static_cast<double>(gen()) / gen.max() * total;
+                auto rank = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+                if (i) line.push_back(' ');
+                line += vocab[std::min<size_t>(rank, vocab.size() - 1)];
+            }
+        }
+        return lines;
+    }
+
+private:
+    std::mt19937 gen;
+};
+
+/**
+ * Value built on first use, so that benchmarks filtered out never pay for their data
+ * Builders that draw random data should seed a Dataset of their own,
+ * so that the data does not depend on which benchmarks ran before
+ */
+template<typename T>
+class Lazy {
+public:
+    explicit Lazy(std::function<void(T &)> build) : build{std::move(build)} {}
+
+    T &Get() {
+        if (!value) {
+            value.reset(new T{});
+            build(*value);
+        }
+        return *value;
+    }
+
+    bool Built() const { return value != nullptr; }
+
+private:
+    std::function<void(T &)> build;
+    std::unique_ptr<T> value;
+};
+
+}
+}
+
+#endif //HARA_BENCH_DATASET_H
@@ -0,0 +1,822 @@
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "hara/Input.h"
+#include "hara/Output.h"
+#include "hara/String.h"
+#include "hara/PrefixTree.h"
+#include "hara/PrefixEncoder.h"
+#include "hara/Pipeline.h"
+#include "hara/ExternalSort.h"
+#include "hara/WordCount.h"
+#include "hara/RecordReader.h"
+#include "hara/Dedup.h"
+#include "hara/PriorityQueue.h"
+#include "Benchmark.h"
+#include "Dataset.h"
+
+using hara::bench::Dataset;
+using hara::bench::Lazy;
+using hara::bench::Runner;
+
+using Strings = Lazy<std::vector<std::string>>;
+
+namespace {
+
+struct Options {
+    unsigned seed = 42;
+    size_t scale = 1;
+    size_t warmup = 1;
+    size_t repetitions = 10;
+    std::string filter;
+    std::string json;
+    std::string tmpdir = "/tmp";
+};
+
+int Usage(const char *program) {
+    std::cerr << "Usage: " << program << " [OPTIONS]" << std::endl;
+    std::cerr << "\t--json PATH: write results as JSON; use '-' for stdout" << std::endl;
+    std::cerr << "\t--filter STR: only run benchmarks whose name contains STR" << std::endl;
+    std::cerr << "\t--repetitions N: timed runs per benchmark (default 10)" << std::endl;
+    std::cerr << "\t--warmup N: untimed runs per benchmark (default 1)" << std::endl;
+    std::cerr << "\t--scale N: multiply dataset sizes by N (default 1)" << std::endl;
+    std::cerr << "\t--seed N: dataset seed (default 42)" << std::endl;
+    std::cerr << "\t--tmpdir DIR: where to write temporary files (default /tmp)" << std::endl;
+    return EXIT_FAILURE;
+}
+
+std::vector<char> Chars(const std::string &s) { return {s.begin(), s.end()}; }
+
+void WriteLines(const std::vector<std::string> &lines, const std::string &path) {
+    hara::Output output{path};
+    for (const auto &line : lines) output << line << '\n';
+}
+
+/**
+ * Input line reading over a file on disk, plain and compressed with every codec built in
+ */
+void BenchInput(Runner &runner, Strings &lines, const std::string &tmpdir) {
+    std::vector<std::pair<std::string, std::string>> files{{"input/getline", tmpdir + "/hara_bench_corpus.txt"}};
+#ifdef HARA_ZLIB
+    files.emplace_back("input/getline_gzip", tmpdir + "/hara_bench_corpus.txt.gz");
+#endif
+#ifdef HARA_ZSTD
+    files.emplace_back("input/getline_zstd", tmpdir + "/hara_bench_corpus.txt.zst");
+#endif
+    for (const auto &file : files) {
+        const auto &path = file.second;
+        Lazy<bool> written{[&lines, &path](bool &) { WriteLines(lines.Get(), path); }};
+        const auto setup = [&lines, &written]() {
+            written.Get();
+            return lines.Get().size();
+        };
+        runner.Run(file.first, "lines", setup, [&path]() {
+            hara::Input input{path};
+            std::string line;
+            size_t bytes = 0;
+            while (input.GetLine(line)) bytes += line.size();
+            return bytes;
+        });
+        runner.Run(file.first + "/view", "lines", setup, [&path]() {
+            hara::Input input{path};
+            hara::StringView line;
+            size_t bytes = 0;
+            while (input.GetLine(line)) bytes += line.size();
+            return bytes;
+        });
+        if (written.Built()) std::remove(path.c_str());
+    }
+}
+
+void BenchString(Runner &runner, Strings &lines) {
+    runner.Run("string/split", "lines", [&lines]() { return lines.Get().size(); }, [&lines]() {
+        size_t tokens = 0;
+        for (const auto &line : lines.Get()) tokens += hara::String::Split(line).size();
+        return tokens;
+    });
+
+    Lazy<std::vector<std::vector<std::string>>> split{[&lines](std::vector<std::vector<std::string>> &split) {
+        split.reserve(lines.Get().size());
+        for (const auto &line : lines.Get()) split.push_back(hara::String::Split(line));
+    }};
+    runner.Run("string/join", "lines", [&split]() { return split.Get().size(); }, [&split]() {
+        size_t bytes = 0;
+        for (const auto &tokens : split.Get()) bytes += hara::String::Join(tokens).size();
+        return bytes;
+    });
+}
+
+void BenchPrefixTree(Runner &runner, unsigned seed, Strings &vocab) {
+    runner.Run("prefixtree/build", "keys", [&vocab]() { return vocab.Get().size(); }, [&vocab]() {
+        hara::PrefixTree<char, size_t> tree;
+        for (size_t idx = 0; idx < vocab.Get().size(); ++idx) tree.Insert(Chars(vocab.Get()[idx]), idx);
+        return tree.Size();
+    });
+
+    struct Fixture {
+        hara::PrefixTree<char, size_t> tree;
+        std::vector<std::vector<char>> queries, prefixes;
+    };
+    Lazy<Fixture> fixture{[seed, &vocab](Fixture &fixture) {
+        const auto &words = vocab.Get();
+        for (size_t idx = 0; idx < words.size(); ++idx) fixture.tree.Insert(Chars(words[idx]), idx);
+        Dataset dataset{seed};
+        for (size_t i = 0; i < words.size(); ++i) {
+            const auto &word = words[dataset.Uniform(words.size())];
+            fixture.queries.push_back(Chars(word));
+            if (i % 50 == 0) fixture.prefixes.emplace_back(word.begin(), word.begin() + 2);
+        }
+    }};
+    runner.Run("prefixtree/lookup", "keys", [&fixture]() { return fixture.Get().queries.size(); }, [&fixture]() {
+        auto &f = fixture.Get();
+        size_t found = 0;
+        for (const auto &query : f.queries) found += f.tree.Find(query) != nullptr;
+        return found;
+    });
+    runner.Run("prefixtree/findall_prefix2", "queries", [&fixture]() { return fixture.Get().prefixes.size(); },
+               [&fixture]() {
+                   auto &f = fixture.Get();
+                   size_t leafs = 0;
+                   for (const auto &prefix : f.prefixes) leafs += f.tree.FindAll(prefix).size();
+                   return leafs;
+               });
+}
+
+/**
+ * PrefixTree at vocabulary scale (--scale 200 loads 10M keys): memory per key,
+ * load and clear cycles, Erase and Insert with their num_leafs updates along the path,
+ * and FindAll over subtrees of growing size
+ */
+void BenchPrefixTreeCorpus(Runner &runner, unsigned seed, Strings &vocab) {
+    Lazy<std::vector<std::vector<char>>> keys{[&vocab](std::vector<std::vector<char>> &keys) {
+        for (const auto &word : vocab.Get()) keys.push_back(Chars(word));
+    }};
+
+    hara::PrefixTree<char, size_t> scratch;
+    runner.Run("prefixtree/corpus/load_clear", "keys", [&keys]() { return keys.Get().size(); },
+               [&scratch, &keys]() {
+                   scratch.Clear();
+                   for (size_t idx = 0; idx < keys.Get().size(); ++idx) scratch.Insert(keys.Get()[idx], idx);
+                   return scratch.Size();
+               });
+    scratch.Clear();
+
+    // loaded outside any timed run, so the cases below never see an empty tree whatever the filter
+    Lazy<hara::PrefixTree<char, size_t>> loaded{[&keys](hara::PrefixTree<char, size_t> &tree) {
+        for (size_t idx = 0; idx < keys.Get().size(); ++idx) tree.Insert(keys.Get()[idx], idx);
+    }};
+    using Component = std::function<size_t(const hara::PrefixTreeMemory &)>;
+    const std::vector<std::pair<std::string, Component>> components{
+            {"", [](const hara::PrefixTreeMemory &memory) { return memory.Total(); }},
+            {"/nodes", [](const hara::PrefixTreeMemory &memory) { return memory.nodes; }},
+            {"/maps", [](const hara::PrefixTreeMemory &memory) { return memory.maps; }},
+            {"/values", [](const hara::PrefixTreeMemory &memory) { return memory.values; }}};
+    for (const auto &component : components) {
+        runner.Report("prefixtree/corpus/memory" + component.first, "B/key", [&loaded, &keys, &component]() {
+            return static_cast<double>(component.second(loaded.Get().MemoryUsage())) / keys.Get().size();
+        });
+    }
+
+    Lazy<std::vector<size_t>> sample{[seed, &keys](std::vector<size_t> &sample) {
+        Dataset dataset{seed};
+        for (size_t i = 0; i < keys.Get().size() / 10; ++i) sample.push_back(dataset.Uniform(keys.Get().size()));
+    }};
+    runner.Run("prefixtree/corpus/erase_insert", "keys", [&loaded, &sample]() {
+                   loaded.Get();
+                   return sample.Get().size();
+               },
+               [&loaded, &keys, &sample]() {
+                   auto &tree = loaded.Get();
+                   size_t erased = 0;
+                   for (const auto idx : sample.Get()) {
+                       const auto &key = keys.Get()[idx];
+                       if (!tree.Erase(key)) continue;
+                       tree.Insert(key, idx);
+                       ++erased;
+                   }
+                   return erased;
+               });
+
+    for (size_t length = 1; length <= 3; ++length) {
+        Lazy<std::vector<std::vector<char>>> prefixes{[seed, length, &keys](std::vector<std::vector<char>> &prefixes) {
+            Dataset dataset{seed + static_cast<unsigned>(length)};
+            for (size_t i = 0; i < 100; ++i) {
+                const auto &key = keys.Get()[dataset.Uniform(keys.Get().size())];
+                prefixes.emplace_back(key.begin(), key.begin() + std::min(length, key.size()));
+            }
+        }};
+        const auto setup = [&loaded, &prefixes]() {
+            auto &tree = loaded.Get();
+            size_t leafs = 0;
+            for (const auto &prefix : prefixes.Get()) leafs += tree.FindAll(prefix).size();
+            return leafs;
+        };
+        runner.Run("prefixtree/corpus/findall_prefix" + std::to_string(length), "leafs", setup,
+                   [&loaded, &prefixes]() {
+                       auto &tree = loaded.Get();
+                       size_t found = 0;
+                       for (const auto &prefix : prefixes.Get()) found += tree.FindAll(prefix).size();
+                       return found;
+                   });
+    }
+}
+
+/**
+ * Levenshtein distance, giving up once every cell of a row exceeds bound
+ */
+size_t EditDistance(const std::string &a, const std::string &b, size_t bound, std::vector<size_t> &prev,
+                    std::vector<size_t> &row) {
+    prev.resize(b.size() + 1);
+    row.resize(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) prev[j] = j;
+    for (size_t i = 1; i <= a.size(); ++i) {
+        row[0] = i;
+        auto min = row[0];
+        for (size_t j = 1; j <= b.size(); ++j) {
+            row[j] = std::min({prev[j] + 1, row[j - 1] + 1, prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1)});
+            min = std::min(min, row[j]);
+        }
+        if (min > bound) return bound + 1;
+        prev.swap(row);
+    }
+    return prev[b.size()];
+}
+
+/**
+ * Words within edit distance k of misspelled vocabulary words,
+ * PrefixTree::FindWithin against a scan computing the distance to every word
+ */
+void BenchFuzzy(Runner &runner, unsigned seed, size_t scale) {
+    struct Fixture {
+        std::vector<std::string> vocab;
+        hara::PrefixTree<char, size_t> tree;
+        std::vector<std::string> queries;
+    };
+    Lazy<Fixture> fixture{[seed, scale](Fixture &fixture) {
+        Dataset dataset{seed};
+        fixture.vocab = dataset.Vocabulary(500000 * scale);
+        const auto &vocab = fixture.vocab;
+        for (size_t idx = 0; idx < vocab.size(); ++idx) fixture.tree.Insert(Chars(vocab[idx]), idx);
+
+        // one random substitution, insertion or deletion per query
+        for (size_t i = 0; i < 200; ++i) {
+            auto word = vocab[dataset.Uniform(vocab.size())];
+            const auto pos = dataset.Uniform(word.size());
+            const auto c = static_cast<char>('a' + dataset.Uniform(26));
+            switch (dataset.Uniform(3)) {
+                case 0: word[pos] = c; break;
+                case 1: word.insert(word.begin() + pos, c); break;
+                default: word.erase(pos, 1);
+            }
+            fixture.queries.push_back(std::move(word));
+        }
+    }};
+
+    const auto setup = [&fixture]() { return fixture.Get().queries.size(); };
+    for (size_t k : {1, 2}) {
+        const auto suffix = "/k" + std::to_string(k);
+        runner.Run("fuzzy/prefixtree" + suffix, "queries", setup, [&fixture, k]() {
+            auto &f = fixture.Get();
+            size_t found = 0;
+            for (const auto &query : f.queries) found += f.tree.FindWithin(Chars(query), k).size();
+            return found;
+        });
+        runner.Run("fuzzy/prefixtree" + suffix + "/best10", "queries", setup, [&fixture, k]() {
+            auto &f = fixture.Get();
+            size_t found = 0;
+            for (const auto &query : f.queries) found += f.tree.FindWithin(Chars(query), k, 10).size();
+            return found;
+        });
+        const size_t num_brute_force = 10;
+        const auto brute_force_setup = [&fixture]() {
+            fixture.Get();
+            return num_brute_force;
+        };
+        runner.Run("fuzzy/brute_force" + suffix, "queries", brute_force_setup, [&fixture, k]() {
+            const auto &f = fixture.Get();
+            size_t found = 0;
+            std::vector<size_t> prev, row;
+            for (size_t i = 0; i < num_brute_force; ++i)
+                for (const auto &word : f.vocab) found += EditDistance(f.queries[i], word, k, prev, row) <= k;
+            return found;
+        });
+    }
+}
+
+void BenchLpm(Runner &runner, Strings &vocab, Strings &lines, const std::string &tmpdir) {
+    // subword vocabulary: the first 4 chars of every word
+    Lazy<hara::PrefixEncoder> encoder{[&vocab](hara::PrefixEncoder &encoder) {
+        for (const auto &word : vocab.Get()) encoder.Insert(word.substr(0, 4));
+    }};
+    const auto setup = [&encoder, &lines]() {
+        encoder.Get();
+        return lines.Get().size();
+    };
+
+    runner.Run("lpm/encode", "lines", setup, [&encoder, &lines]() {
+        size_t bytes = 0;
+        std::string encoded;
+        for (const auto &line : lines.Get()) {
+            encoder.Get().Encode(line, encoded);
+            bytes += encoded.size();
+        }
+        return bytes;
+    });
+
+    runner.Run("lpm/encode_ids", "lines", setup, [&encoder, &lines]() {
+        size_t num_ids = 0;
+        std::vector<uint32_t> ids;
+        for (const auto &line : lines.Get()) {
+            encoder.Get().EncodeIds(line, ids);
+            num_ids += ids.size();
+        }
+        return num_ids;
+    });
+
+    // end to end through the reader / workers / writer pipeline
+    const auto path = tmpdir + "/hara_bench_lpm.txt";
+    Lazy<bool> written{[&lines, &path](bool &) { WriteLines(lines.Get(), path); }};
+    for (size_t num_threads : {1, 2, 4, 8}) {
+        runner.Run("lpm/pipeline/threads" + std::to_string(num_threads), "lines",
+                   [&setup, &written]() {
+                       written.Get();
+                       return setup();
+                   },
+                   [&encoder, &path, num_threads]() {
+                       hara::Input input{path};
+                       hara::Output output{"/dev/null"};
+                       auto &prefix_encoder = encoder.Get();
+                       hara::Pipeline{num_threads}.Run(input, output, [&prefix_encoder](const std::string &line,
+                                                                                        std::string &encoded) {
+                           prefix_encoder.Encode(line, encoded);
+                           encoded.push_back('\n');
+                       });
+                       return num_threads;
+                   });
+    }
+    if (written.Built()) std::remove(path.c_str());
+}
+
+/**
+ * ExternalSort fully in memory and with spilled runs, over a file on disk
+ */
+void BenchSort(Runner &runner, Strings &lines, const std::string &tmpdir) {
+    const auto path = tmpdir + "/hara_bench_sort.txt";
+    // bytes of the file
+    Lazy<size_t> bytes{[&lines, &path](size_t &bytes) {
+        WriteLines(lines.Get(), path);
+        for (const auto &line : lines.Get()) bytes += line.size() + 1;
+    }};
+    struct Config {
+        std::string name;
+        // memory limit relative to the file size
+        double memory_ratio;
+        size_t num_threads;
+        bool count;
+    };
+    const std::vector<Config> configs{
+            {"sort/in_memory",            4,     1, false},
+            {"sort/in_memory/threads4",   4,     4, false},
+            {"sort/external8",            1. / 8, 1, false},
+            {"sort/external8/threads4",   1. / 8, 4, false},
+            {"sort/external8/count",      1. / 8, 1, true},
+    };
+    for (const auto &config : configs) {
+        const auto setup = [&bytes, &lines]() {
+            bytes.Get();
+            return lines.Get().size();
+        };
+        runner.Run(config.name, "lines", setup, [&config, &bytes, &path, &tmpdir]() {
+            hara::ExternalSort::Options options;
+            options.memory_limit = static_cast<size_t>(static_cast<double>(bytes.Get()) * config.memory_ratio);
+            options.num_threads = config.num_threads;
+            options.count = config.count;
+            options.tmpdir = tmpdir;
+            hara::Input input{path};
+            hara::Output output{"/dev/null"};
+            hara::ExternalSort sort{options};
+            sort.Run(input, output);
+            return sort.NumRuns();
+        });
+    }
+    if (bytes.Built()) std::remove(path.c_str());
+}
+
+/**
+ * Word frequencies over a file on disk, against counting a single key with String::Split
+ */
+void BenchWordCount(Runner &runner, Strings &lines, const std::string &tmpdir) {
+    const auto path = tmpdir + "/hara_bench_wordcount.txt";
+    Lazy<bool> written{[&lines, &path](bool &) { WriteLines(lines.Get(), path); }};
+    const auto setup = [&written, &lines]() {
+        written.Get();
+        return lines.Get().size();
+    };
+    runner.Run("wordcount/split_single_key", "lines", setup, [&path, &lines]() {
+        const auto &first = lines.Get().front();
+        const auto key = first.substr(0, first.find(' '));
+        hara::Input input{path};
+        std::string line;
+        size_t counter = 0;
+        while (input.GetLine(line))
+            for (const auto &token : hara::String::Split(line))
+                if (token == key) ++counter;
+        return counter;
+    });
+    for (size_t num_threads : {1, 2, 4, 8}) {
+        runner.Run("wordcount/threads" + std::to_string(num_threads), "lines", setup,
+                   [&path, num_threads]() {
+                       hara::Input input{path};
+                       hara::WordCount counter{num_threads};
+                       counter.Add(input);
+                       return counter.Table().Size();
+                   });
+    }
+    if (written.Built()) std::remove(path.c_str());
+}
+
+/**
+ * Two columns out of a wide TSV file: String::Split against RecordReader views and typed batches,
+ * plus the same projection over CSV with quoted fields
+ */
+void BenchRecords(Runner &runner, unsigned seed, Strings &vocab, size_t scale, const std::string &tmpdir) {
+    const size_t num_rows = 50000 * scale, num_columns = 40, id_column = 4, word_column = 17;
+    const auto tsv = tmpdir + "/hara_bench_records.tsv", csv = tmpdir + "/hara_bench_records.csv";
+    Lazy<bool> written{[&](bool &) {
+        const auto &words = vocab.Get();
+        Dataset dataset{seed};
+        hara::Output tsv_output{tsv}, csv_output{csv};
+        for (size_t row = 0; row < num_rows; ++row) {
+            for (size_t column = 0; column < num_columns; ++column) {
+                const auto &word = words[dataset.Uniform(words.size())];
+                const auto field = column % 2 ? word : std::to_string(dataset.Uniform(1000000));
+                tsv_output << (column ? "\t" : "") << field;
+                csv_output << (column ? "," : "") << (column % 4 == 1 ? "\"" + word + ", " + word + "\"" : field);
+            }
+            tsv_output << '\n';
+            csv_output << '\n';
+        }
+    }};
+    const auto setup = [&written, num_rows]() {
+        written.Get();
+        return num_rows;
+    };
+
+    runner.Run("records/split", "rows", setup, [&tsv]() {
+        hara::Input input{tsv};
+        std::string line;
+        size_t sum = 0;
+        while (input.GetLine(line)) {
+            const auto fields = hara::String::Split(line, [](char c) { return c == '\t'; });
+            sum += std::stoll(fields[id_column]) + fields[word_column].size();
+        }
+        return sum;
+    });
+    runner.Run("records/fields", "rows", setup, [&tsv]() {
+        hara::Input input{tsv};
+        hara::RecordReader reader{input, {id_column, word_column}};
+        size_t sum = 0;
+        while (reader.Next()) sum += std::stoll(reader.Field(0).ToString()) + reader.Field(1).size();
+        return sum;
+    });
+    runner.Run("records/batch", "rows", setup, [&tsv]() {
+        hara::Input input{tsv};
+        hara::RecordReader reader{input, {id_column, word_column}};
+        hara::ColumnBatch batch{{hara::ColumnType::Int, hara::ColumnType::String}};
+        size_t sum = 0;
+        while (reader.NextBatch(batch, 1024) > 0)
+            for (size_t row = 0; row < batch.NumRows(); ++row)
+                sum += batch.Ints(0)[row] + batch.Strings(1)[row].size();
+        return sum;
+    });
+    runner.Run("records/csv_quoted/batch", "rows", setup, [&csv]() {
+        hara::Input input{csv};
+        hara::RecordReader reader{input, {id_column, word_column}, hara::RecordReader::Csv()};
+        hara::ColumnBatch batch{{hara::ColumnType::Int, hara::ColumnType::String}};
+        size_t sum = 0;
+        while (reader.NextBatch(batch, 1024) > 0)
+            for (size_t row = 0; row < batch.NumRows(); ++row)
+                sum += batch.Ints(0)[row] + batch.Strings(1)[row].size();
+        return sum;
+    });
+    if (written.Built()) {
+        std::remove(tsv.c_str());
+        std::remove(csv.c_str());
+    }
+}
+
+/**
+ * First occurrences of lines drawn with repetition from a quarter of the corpus,
+ * against an unordered_set of line copies and a sort -u
+ */
+void BenchDedup(Runner &runner, unsigned seed, Strings &lines, const std::string &tmpdir) {
+    const auto path = tmpdir + "/hara_bench_dedup.txt";
+    Lazy<bool> written{[seed, &lines, &path](bool &) {
+        const auto &corpus = lines.Get();
+        Dataset dataset{seed};
+        hara::Output output{path};
+        for (size_t i = 0; i < corpus.size(); ++i) output << corpus[dataset.Uniform(corpus.size() / 4 + 1)] << '\n';
+    }};
+    const auto setup = [&written, &lines]() {
+        written.Get();
+        return lines.Get().size();
+    };
+    runner.Run("dedup/exact", "lines", setup, [&path]() {
+        hara::Input input{path};
+        hara::Output output{"/dev/null"};
+        hara::Dedup dedup{hara::Dedup::Options{}};
+        dedup.Run(input, output);
+        return dedup.NumUnique();
+    });
+    runner.Run("dedup/bloom", "lines", setup, [&path, &lines]() {
+        hara::Input input{path};
+        hara::Output output{"/dev/null"};
+        hara::Dedup::Options options;
+        // about 16 bits per line
+        options.filter_bytes = 2 * lines.Get().size();
+        hara::Dedup dedup{options};
+        dedup.Run(input, output);
+        return dedup.NumUnique();
+    });
+    runner.Run("dedup/unordered_set", "lines", setup, [&path]() {
+        hara::Input input{path};
+        hara::Output output{"/dev/null"};
+        std::unordered_set<std::string> seen;
+        std::string line;
+        while (input.GetLine(line))
+            if (seen.insert(line).second) output << line << '\n';
+        return seen.size();
+    });
+    runner.Run("dedup/sort_unique", "lines", setup, [&path, &tmpdir]() {
+        hara::ExternalSort::Options options;
+        options.unique = true;
+        options.tmpdir = tmpdir;
+        hara::Input input{path};
+        hara::Output output{"/dev/null"};
+        hara::ExternalSort sort{options};
+        sort.Run(input, output);
+        return sort.NumRuns();
+    });
+    if (written.Built()) std::remove(path.c_str());
+}
+
+/**
+ * Whitespace separated integers and doubles through Output << and Input >>, against plain iostreams
+ * --scale 50 writes and reads 100M integers
+ */
+void BenchNumbers(Runner &runner, unsigned seed, size_t scale, const std::string &tmpdir) {
+    const size_t count = 2000000 * scale;
+    // written by the write benchmarks; the read ones have files of their own
+    const auto path = tmpdir + "/hara_bench_numbers.txt";
+    const auto ints_path = tmpdir + "/hara_bench_ints.txt", doubles_path = tmpdir + "/hara_bench_doubles.txt";
+    Lazy<std::vector<int64_t>> ints{[seed, count](std::vector<int64_t> &ints) {
+        Dataset dataset{seed};
+        ints.resize(count);
+        for (auto &value : ints) value = static_cast<int64_t>(dataset.Uniform(2000000000)) - 1000000000;
+    }};
+    Lazy<std::vector<double>> doubles{[seed, count](std::vector<double> &doubles) {
+        Dataset dataset{seed};
+        doubles.resize(count / 4);
+        for (auto &value : doubles) value = static_cast<double>(dataset.Uniform(1000000000)) / 1024;
+    }};
+    Lazy<bool> ints_written{[&ints, &ints_path](bool &) {
+        hara::Output output{ints_path};
+        for (const auto value : ints.Get()) output << value << '\n';
+    }};
+    Lazy<bool> doubles_written{[&doubles, &doubles_path](bool &) {
+        hara::Output output{doubles_path};
+        for (const auto value : doubles.Get()) output << value << '\n';
+    }};
+    const auto int_setup = [&ints]() { return ints.Get().size(); };
+    const auto double_setup = [&doubles]() { return doubles.Get().size(); };
+
+    runner.Run("numbers/write_int", "numbers", int_setup, [&path, &ints]() {
+        hara::Output output{path};
+        for (const auto value : ints.Get()) output << value << '\n';
+        return ints.Get().size();
+    });
+    runner.Run("numbers/write_int_ofstream", "numbers", int_setup, [&path, &ints]() {
+        std::ofstream output{path};
+        for (const auto value : ints.Get()) output << value << '\n';
+        return ints.Get().size();
+    });
+    const auto read_int_setup = [&ints_written, &int_setup]() {
+        ints_written.Get();
+        return int_setup();
+    };
+    runner.Run("numbers/read_int", "numbers", read_int_setup, [&ints_path]() {
+        hara::Input input{ints_path};
+        int64_t value, sum = 0;
+        while (input >> value) sum += value;
+        return static_cast<size_t>(sum);
+    });
+    runner.Run("numbers/read_int_ifstream", "numbers", read_int_setup, [&ints_path]() {
+        std::ifstream input{ints_path};
+        int64_t value, sum = 0;
+        while (input >> value) sum += value;
+        return static_cast<size_t>(sum);
+    });
+
+    runner.Run("numbers/write_double", "numbers", double_setup, [&path, &doubles]() {
+        hara::Output output{path};
+        for (const auto value : doubles.Get()) output << value << '\n';
+        return doubles.Get().size();
+    });
+    runner.Run("numbers/write_double_ofstream", "numbers", double_setup, [&path, &doubles]() {
+        std::ofstream output{path};
+        output.precision(17);
+        for (const auto value : doubles.Get()) output << value << '\n';
+        return doubles.Get().size();
+    });
+    const auto read_double_setup = [&doubles_written, &double_setup]() {
+        doubles_written.Get();
+        return double_setup();
+    };
+    runner.Run("numbers/read_double", "numbers", read_double_setup, [&doubles_path]() {
+        hara::Input input{doubles_path};
+        double value, sum = 0;
+        while (input >> value) sum += value;
+        return static_cast<size_t>(sum);
+    });
+    runner.Run("numbers/read_double_ifstream", "numbers", read_double_setup, [&doubles_path]() {
+        std::ifstream input{doubles_path};
+        double value, sum = 0;
+        while (input >> value) sum += value;
+        return static_cast<size_t>(sum);
+    });
+    std::remove(path.c_str());
+    if (ints_written.Built()) std::remove(ints_path.c_str());
+    if (doubles_written.Built()) std::remove(doubles_path.c_str());
+}
+
+enum {
+    INSERT = 0,
+    ERASE = 1,
+    TOP = 2,
+    POP = 3,
+    PEEK = 4
+};
+
+struct Operation {
+    int op;
+    size_t key;
+    int value;
+};
+
+template<typename Queue>
+size_t PerformOperations(const std::vector<std::string> &keys, const std::vector<Operation> &ops) {
+    Queue queue;
+    size_t checksum = 0;
+    for (const auto &operation : ops) {
+        const auto &key = keys[operation.key];
+        switch (operation.op) {
+            case INSERT:
+                queue.InsertOrUpdate({key, operation.value});
+                break;
+            case ERASE:
+                queue.Erase(key);
+                break;
+            case TOP:
+                queue.InsertOrUpdate({key, operation.value});
+                checksum += queue.Top().second;
+                break;
+            case POP:
+                queue.Pop();
+                break;
+            case PEEK:
+                queue.InsertOrUpdate({key, operation.value});
+                checksum += queue.Peek(key);
+                break;
+            default:
+                break;
+        }
+    }
+    return checksum + queue.Size();
+}
+
+template<typename Queue>
+size_t PerformBatches(const std::vector<std::vector<std::pair<std::string, int>>> &batches, size_t drain) {
+    Queue queue;
+    std::vector<std::pair<std::string, int>> out;
+    for (const auto &batch : batches) {
+        queue.InsertOrUpdateMany(batch);
+        queue.PopN(drain, out);
+    }
+    return out.size();
+}
+
+struct QueueWorkload {
+    std::vector<std::string> keys;
+    std::vector<Operation> uniform, increasing;
+    std::vector<std::vector<std::pair<std::string, int>>> batches;
+    size_t updates = 0;
+};
+
+template<typename Queue>
+void BenchBackend(Runner &runner, const std::string &name, Lazy<QueueWorkload> &workload, size_t drain) {
+    runner.Run("pqueue/" + name + "/uniform", "ops", [&workload]() { return workload.Get().uniform.size(); },
+               [&workload]() { return PerformOperations<Queue>(workload.Get().keys, workload.Get().uniform); });
+    runner.Run("pqueue/" + name + "/decrease_key", "ops", [&workload]() { return workload.Get().increasing.size(); },
+               [&workload]() { return PerformOperations<Queue>(workload.Get().keys, workload.Get().increasing); });
+    runner.Run("pqueue/" + name + "/batched", "ops", [&workload]() { return workload.Get().updates; },
+               [&workload, drain]() { return PerformBatches<Queue>(workload.Get().batches, drain); });
+}
+
+void BenchPriorityQueue(Runner &runner, unsigned seed, size_t scale) {
+    Lazy<QueueWorkload> workload{[seed, scale](QueueWorkload &workload) {
+        const size_t num_keys = 10000;
+        const size_t num_ops = 1000000 * scale;
+        const int max_value = 100000000;
+
+        Dataset dataset{seed};
+        workload.keys = dataset.Vocabulary(num_keys, 5, 5);
+
+        // every operation equally likely
+        workload.uniform.resize(num_ops);
+        for (auto &operation : workload.uniform)
+            operation = Operation{static_cast<int>(dataset.Uniform(PEEK + 1)), dataset.Uniform(num_keys),
+                                  static_cast<int>(dataset.Uniform(max_value))};
+
+        // keys mostly move towards the top
+        std::vector<int> priority(num_keys, 0);
+        workload.increasing.resize(num_ops);
+        for (auto &operation : workload.increasing) {
+            const auto key = dataset.Uniform(num_keys);
+            const auto mix = dataset.Uniform(100);
+            const int op = mix < 90 ? INSERT : mix < 95 ? TOP : POP;
+            if (op != POP) priority[key] += 1 + static_cast<int>(dataset.Uniform(1000));
+            operation = Operation{op, key, priority[key]};
+        }
+
+        // large batches of updates, each followed by a small drain
+        workload.batches.resize(num_ops / 20000);
+        for (auto &batch : workload.batches) {
+            for (size_t i = 0; i < 20000; ++i)
+                batch.emplace_back(workload.keys[dataset.Uniform(num_keys)],
+                                   static_cast<int>(dataset.Uniform(max_value)));
+            workload.updates += batch.size();
+        }
+    }};
+
+    BenchBackend<hara::PriorityQueue1<std::string, int>>(runner, "impl1", workload, 300);
+    BenchBackend<hara::PriorityQueue2<std::string, int>>(runner, "impl2", workload, 300);
+    BenchBackend<hara::PriorityQueue3<std::string, int>>(runner, "impl3", workload, 300);
+}
+
+}
+
+/**
+ * hara_bench [OPTIONS]
+ * Seeded micro/macro benchmarks of every hara component
+ * Human-readable results go to stderr, JSON to the --json path
+ */
+int main(int argc, const char **argv) {
+    Options options;
+    for (int idx = 1; idx < argc; ++idx) {
+        const std::string arg{argv[idx]};
+        if (idx + 1 >= argc) return Usage(argv[0]);
+        const std::string value{argv[++idx]};
+        if (arg == "--json") options.json = value;
+        else if (arg == "--filter") options.filter = value;
+        else if (arg == "--repetitions") options.repetitions = std::stoul(value);
+        else if (arg == "--warmup") options.warmup = std::stoul(value);
+        else if (arg == "--scale") options.scale = std::max<size_t>(1, std::stoul(value));
+        else if (arg == "--seed") options.seed = static_cast<unsigned>(std::stoul(value));
+        else if (arg == "--tmpdir") options.tmpdir = value;
+        else return Usage(argv[0]);
+    }
+
+    // built only once a selected benchmark needs them
+    Strings vocab{[&options](std::vector<std::string> &vocab) {
+        vocab = Dataset{options.seed}.Vocabulary(50000 * options.scale);
+    }};
+    Strings lines{[&options, &vocab](std::vector<std::string> &lines) {
+        lines = Dataset{options.seed + 1}.Corpus(vocab.Get(), 100000 * options.scale, 12);
+    }};
+
+    Runner runner{options.warmup, options.repetitions, options.filter};
+    BenchInput(runner, lines, options.tmpdir);
+    BenchString(runner, lines);
+    BenchPrefixTree(runner, options.seed, vocab);
+    BenchPrefixTreeCorpus(runner, options.seed, vocab);
+    BenchLpm(runner, vocab, lines, options.tmpdir);
+    BenchSort(runner, lines, options.tmpdir);
+    BenchWordCount(runner, lines, options.tmpdir);
+    BenchRecords(runner, options.seed, vocab, options.scale, options.tmpdir);
+    BenchDedup(runner, options.seed, lines, options.tmpdir);
+    BenchNumbers(runner, options.seed, options.scale, options.tmpdir);
+    BenchPriorityQueue(runner, options.seed, options.scale);
+    BenchFuzzy(runner, options.seed, options.scale);
+
+    if (options.json == "-") {
+        runner.WriteJson(std::cout, options.seed, options.scale);
+    } else if (!options.json.empty()) {
+        std::ofstream ofs{options.json};
+        runner.WriteJson(ofs, options.seed, options.scale);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hara/ConcurrentPriorityQueue.h"
+#include "hara/Macros.h"
+
+using Queue = hara::ConcurrentPriorityQueue2<int, int>;
+
+constexpr int NUM_KEYS = 1000000;
+constexpr int NUM_OPERATIONS = 4000000;
+constexpr int NUM_POPS = 200000;
+constexpr unsigned SEED = 42;
+
+/**
+ * Each thread runs its share of a 50/50 InsertOrUpdate / Pop mix
+ * @return ops/sec
+ */
+double MixedThroughput(Queue &queue, size_t num_threads) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&queue, num_threads, t]() {
+            std::mt19937 gen(SEED + t);
+            std::uniform_int_distribution<> key_dis{0, NUM_KEYS - 1};
+            std::uniform_int_distribution<> val_dis{0, 100000000};
+            std::pair<int, int> top;
+            for (size_t i = 0; i < NUM_OPERATIONS / num_threads; ++i) {
+                if (gen() & 1u) queue.InsertOrUpdate({key_dis(gen), val_dis(gen)});
+                else queue.Pop(top);
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    auto end = std::chrono::steady_clock::now();
+    return NUM_OPERATIONS / std::chrono::duration<double>(end - start).count();
+}
+
+/**
+ * Prefill with distinct values 0..NUM_KEYS-1, pop concurrently while tagging every pop
+ * with a global sequence number, then replay the pops in sequence order to find
+ * how many better elements were still in the queue at each pop
+ * @return mean and max rank error
+ */
+std::pair<double, size_t> RankError(Queue &queue, size_t num_threads) {
+    for (int key = 0; key < NUM_KEYS; ++key) queue.InsertOrUpdate({key, key});
+
+    std::atomic<size_t> sequence{0};
+    std::vector<std::vector<std::pair<size_t, int>>> popped(num_threads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            std::pair<int, int> top;
+            for (size_t i = 0; i < NUM_POPS / num_threads && queue.Pop(top); ++i)
+                popped[t].emplace_back(sequence.fetch_add(1), top.second);
+        });
+    }
+    for (auto &thread : threads) thread.join();
+
+    std::vector<std::pair<size_t, int>> pops;
+    for (const auto &p : popped) pops.insert(pops.end(), p.begin(), p.end());
+    std::sort(pops.begin(), pops.end());
+
+    // Fenwick tree over remaining values; max-queue so better means larger value
+    std::vector<size_t> tree(NUM_KEYS + 1, 0);
+    auto add = [&tree](int value, long delta) {
+        for (auto i = static_cast<size_t>(value) + 1; i < tree.size(); i += i & (~i + 1)) tree[i] += delta;
+    };
+    auto prefix = [&tree](int value) {
+        size_t sum = 0;
+        for (auto i = static_cast<size_t>(value) + 1; i > 0; i -= i & (~i + 1)) sum += tree[i];
+        return sum;
+    };
+    for (int value = 0; value < NUM_KEYS; ++value) add(value, 1);
+
+    size_t remaining = NUM_KEYS, total = 0, worst = 0;
+    for (const auto &pop : pops) {
+        const auto rank = remaining - prefix(pop.second);
+        total += rank;
+        worst = std::max(worst, rank);
+        add(pop.second, -1);
+        --remaining;
+    }
+    return {pops.empty() ? 0. : static_cast<double>(total) / pops.size(), worst};
+}
+
+/**
+ * concurrent_pqueue_performance [num_threads]
+ * report ops/sec of a mixed workload and rank error of concurrent pops
+ * for both strict and relaxed ordering
+ */
+int main(int argc, const char **argv) {
+    const size_t num_threads = argc >= 2 ? std::stoul(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "threads: " << num_threads << std::endl;
+
+    for (auto ordering : {Queue::Ordering::Strict, Queue::Ordering::Relaxed}) {
+        const std::string name{ordering == Queue::Ordering::Strict ? "strict" : "relaxed"};
+        {
+            Queue queue{ordering, num_threads};
+            std::cout << name << " mixed: " << static_cast<size_t>(MixedThroughput(queue, num_threads))
+                      << " ops/sec" << std::endl;
+        }
+        {
+            Queue queue{ordering, num_threads};
+            auto error = RankError(queue, num_threads);
+            std::cout << name << " rank error: mean " << error.first << ", max " << error.second << std::endl;
+            if (ordering == Queue::Ordering::Strict && num_threads == 1)
+                ASSERT(error.second == 0, "Strict ordering popped out of order");
+        }
+    }
+
+    return 0;
+}
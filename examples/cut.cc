@@ -0,0 +1,56 @@
+#include <iostream>
+#include "hara/Input.h"
+#include "hara/Output.h"
+#include "hara/RecordReader.h"
+#include "hara/String.h"
+
+int Usage(const char *program) {
+    std::cerr << "Usage: " << program << " [--csv] --fields N,M,... [filename1 filename2 ...]" << std::endl;
+    std::cerr << "\t--csv: comma-separated with quoted fields instead of tab-separated" << std::endl;
+    std::cerr << "\t--fields N,M,...: 1-based columns to print, in that order" << std::endl;
+    return EXIT_FAILURE;
+}
+
+void cut(const std::string &path, const std::vector<size_t> &columns, const hara::RecordReader::Options &options,
+         hara::Output &output) {
+    hara::Input input{path};
+    hara::RecordReader reader{input, columns, options};
+    while (reader.Next()) {
+        for (size_t idx = 0; idx < reader.NumColumns(); ++idx) {
+            if (idx) output << '\t';
+            output << reader.Field(idx);
+        }
+        output << '\n';
+    }
+}
+
+/**
+ * cut [--csv] --fields N,M,... [filename1 filename2 ...]
+ * print the given columns of every record, tab-separated
+ * If no filename is provided, read from stdin
+ */
+int main(int argc, const char** argv) {
+    auto options = hara::RecordReader::Tsv();
+    std::vector<size_t> columns;
+    int arg = 1;
+    for (; arg < argc && std::string{argv[arg]}.compare(0, 2, "--") == 0; ++arg) {
+        const std::string option{argv[arg]};
+        if (option == "--csv") {
+            options = hara::RecordReader::Csv();
+        } else if (option == "--fields" && arg + 1 < argc) {
+            for (const auto &field : hara::String::Split(argv[++arg], [](char c) { return c == ','; })) {
+                if (std::stoul(field) == 0) return Usage(argv[0]);
+                columns.push_back(std::stoul(field) - 1);
+            }
+        } else {
+            return Usage(argv[0]);
+        }
+    }
+    if (columns.empty()) return Usage(argv[0]);
+
+    hara::Output output{"-"};
+    if (arg == argc) cut("-", columns, options, output);
+    for (; arg < argc; ++arg) cut(argv[arg], columns, options, output);
+
+    return 0;
+}
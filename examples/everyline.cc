@@ -18,6 +18,7 @@ int main(int argc, const char** argv) {
         auto token = hara::String::Split(line);
         out.WriteLine(hara::String::Join(token, "\n"));
     }
+    out.Close();
 
     return 0;
 }
@@ -2,58 +2,82 @@
 #include "hara/Input.h"
 #include "hara/Output.h"
 #include "hara/String.h"
-#include "hara/PrefixTree.h"
+#include "hara/PrefixEncoder.h"
+#include "hara/Pipeline.h"
 
 int Usage(const char *program) {
-    std::cerr << "Usage: " << program << " VOCAB INPUT [OUTPUT]" << std::endl;
+    std::cerr << "Usage: " << program << " [--threads N] [--format FORMAT] VOCAB INPUT [OUTPUT]" << std::endl;
+    std::cerr << "\t--threads N: number of encoding threads (default 1)" << std::endl;
+    std::cerr << "\t--format FORMAT: one of" << std::endl;
+    std::cerr << "\t\ttext: matched units separated by spaces (default)" << std::endl;
+    std::cerr << "\t\tids: vocabulary ids separated by spaces; 0 is <unk>, tokens are numbered from 1 by first appearance in VOCAB"
+              << std::endl;
+    std::cerr << "\t\tbinary: per line, a little-endian uint32 count followed by as many little-endian uint32 ids"
+              << std::endl;
     std::cerr << "\tVOCAB: file containing vocabulary" << std::endl;
     std::cerr << "\tINPUT: text file to encode; use '-' to read from stdin" << std::endl;
     std::cerr << "\tOUTPUT: output file to print result; use '-' or omit to print to stdout" << std::endl;
     return EXIT_FAILURE;
 }
 
+void AppendLittleEndian(uint32_t value, std::string &out) {
+    for (int shift = 0; shift < 32; shift += 8)
+        out.push_back(static_cast<char>((value >> shift) & 0xffu));
+}
+
 int main(int argc, const char** argv) {
-    if (argc != 3 && argc != 4) return Usage(argv[1]);
-    const std::string vocab_file{argv[1]};
-    const std::string input_file{argv[2]};
-    const std::string output_file{argc == 4 ? argv[3] : "-"};
+    size_t num_threads = 1;
+    std::string format{"text"};
+    int arg = 1;
+    for (; arg + 1 < argc && std::string{argv[arg]}.compare(0, 2, "--") == 0; arg += 2) {
+        const std::string option{argv[arg]};
+        if (option == "--threads") num_threads = std::stoul(argv[arg + 1]);
+        else if (option == "--format") format = argv[arg + 1];
+        else return Usage(argv[0]);
+    }
+    const int num_args = argc - arg;
+    if (num_args != 2 && num_args != 3) return Usage(argv[0]);
+    if (format != "text" && format != "ids" && format != "binary") return Usage(argv[0]);
+    const std::string vocab_file{argv[arg]};
+    const std::string input_file{argv[arg + 1]};
+    const std::string output_file{num_args == 3 ? argv[arg + 2] : "-"};
 
-    hara::PrefixTree<char, std::string> prefixTree;
+    hara::PrefixEncoder encoder;
     {
         hara::Input input{vocab_file};
-        auto tokens = hara::String::Split(input.Read());
-        for (const auto &token : tokens) {
-            prefixTree.Insert(std::vector<char>{token.begin(), token.end()}, token);
-        }
+        for (const auto &token : hara::String::Split(input.Read()))
+            encoder.Insert(token);
     }
 
     {
         hara::Input input{input_file};
-        hara::Output output{output_file};
-        std::string line;
-        while (input.GetLine(line)) {
-            std::vector<std::string> encoded;
-            for (const auto &token : hara::String::Split(line)) {
-                std::vector<char> unit;
-                std::string result = "<unk>";
-                for (auto idx = 0; idx < token.size(); ++idx) {
-                    auto c = token.at(idx);
-                    unit.push_back(c);
-                    auto node = prefixTree.FindAll(unit);
-                    if (node.empty()) {
-                        encoded.push_back(std::move(result));
-                        result = "<unk>";
-                        --idx;
-                        unit.clear();
-                    } else {
-                        result = std::string{unit.begin(), unit.end()};
+        hara::Output output{output_file, std::ios_base::out | std::ios_base::binary};
+        hara::Pipeline pipeline{num_threads};
+        if (format == "text") {
+            pipeline.Run(input, output, [&encoder](const std::string &line, std::string &encoded) {
+                encoder.Encode(line, encoded);
+                encoded.push_back('\n');
+            });
+        } else {
+            const bool binary = format == "binary";
+            pipeline.Run(input, output, [&encoder, binary](const std::string &line, std::string &encoded) {
+                static thread_local std::vector<uint32_t> ids;
+                encoder.EncodeIds(line, ids);
+                encoded.clear();
+                if (binary) {
+                    AppendLittleEndian(static_cast<uint32_t>(ids.size()), encoded);
+                    for (auto id : ids) AppendLittleEndian(id, encoded);
+                } else {
+                    for (auto id : ids) {
+                        if (!encoded.empty()) encoded.push_back(' ');
+                        encoded.append(std::to_string(id));
                     }
+                    encoded.push_back('\n');
                 }
-                encoded.push_back(std::move(result));
-            }
-            output << hara::String::Join(encoded) << std::endl;
+            });
         }
+        output.Close();
     }
 
     return 0;
-}
\ No newline at end of file
+}
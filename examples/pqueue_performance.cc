@@ -1,9 +1,23 @@
 #include <random>
 #include <chrono>
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
 #include "hara/PriorityQueue.h"
 #include "hara/Macros.h"
 
+// every global allocation made by this program
+static size_t num_allocations = 0;
+
+void *operator new(size_t size) {
+    ++num_allocations;
+    if (auto p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
 enum {
     INSERT = 0,
     ERASE = 1,
@@ -58,6 +72,51 @@ PerformOperations(Sorted &sorted, const std::vector<Operation> &ops, long long i
     return result;
 }
 
+/**
+ * Apply each batch of updates and then drain the top `drain` elements
+ * If bulk, use InsertOrUpdateMany / PopN instead of one call per element
+ */
+template<typename Sorted>
+std::vector<std::pair<std::string, int>>
+PerformBatches(Sorted &sorted, const std::vector<std::vector<std::pair<std::string, int>>> &batches,
+               size_t drain, bool bulk, long long int &duration) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::pair<std::string, int>> result;
+    for (const auto &batch : batches) {
+        if (bulk) {
+            sorted.InsertOrUpdateMany(batch);
+            const auto top = sorted.TopN(drain);
+            const auto first = result.size();
+            sorted.PopN(drain, result);
+            ASSERT(std::equal(top.begin(), top.end(), result.begin() + first), "TopN does not match PopN");
+        } else {
+            for (const auto &pair : batch)
+                sorted.InsertOrUpdate(pair);
+            for (size_t i = 0; i < drain && !sorted.Empty(); ++i) {
+                result.push_back(sorted.Top());
+                sorted.Pop();
+            }
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    return result;
+}
+
+/**
+ * Fill with every key, then update existing keys only
+ * @return number of global allocations made during the updates
+ */
+template<typename Sorted>
+size_t CountUpdateAllocations(Sorted &sorted, const std::vector<Operation> &ops) {
+    for (int idx = 0; idx < static_cast<int>(keys.size()); ++idx)
+        sorted.InsertOrUpdate({keys[idx], idx});
+    const auto before = num_allocations;
+    for (const auto &operation : ops)
+        sorted.InsertOrUpdate({keys[operation.key % keys.size()], operation.value});
+    return num_allocations - before;
+}
+
 int main(int argc, const char** argv) {
     constexpr int NUM_OPERATIONS = 10000000;
     constexpr int NUM_KEYS = 10000;
@@ -98,7 +157,83 @@ int main(int argc, const char** argv) {
     auto result2 = PerformOperations(pqueue2, ops, duration);
     std::cout << "Impl2: " << duration << "ms" << std::endl;
 
+    hara::PriorityQueue3<std::string, int> pqueue3;
+    auto result3 = PerformOperations(pqueue3, ops, duration);
+    std::cout << "Impl3: " << duration << "ms" << std::endl;
+
     ASSERT(result1 == result2, "Implementations do not match");
+    ASSERT(result1 == result3, "Implementations do not match");
+
+    constexpr int NUM_BATCHES = 50;
+    constexpr int BATCH_SIZE = 20000;
+    constexpr int DRAIN_SIZE = 300;
+
+    std::vector<std::vector<std::pair<std::string, int>>> batches(NUM_BATCHES);
+    for (auto &batch : batches) {
+        batch.reserve(BATCH_SIZE);
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            batch.emplace_back(keys[idx_dis(gen) % NUM_KEYS], val_dis(gen));
+    }
+
+    std::vector<std::vector<std::pair<std::string, int>>> results;
+    for (bool bulk : {false, true}) {
+        const std::string mode{bulk ? "batched" : "per-call"};
+        hara::PriorityQueue1<std::string, int> batched1;
+        results.push_back(PerformBatches(batched1, batches, DRAIN_SIZE, bulk, duration));
+        std::cout << "Impl1 " << mode << ": " << duration << "ms" << std::endl;
+
+        hara::PriorityQueue2<std::string, int> batched2;
+        results.push_back(PerformBatches(batched2, batches, DRAIN_SIZE, bulk, duration));
+        std::cout << "Impl2 " << mode << ": " << duration << "ms" << std::endl;
+
+        hara::PriorityQueue3<std::string, int> batched3;
+        results.push_back(PerformBatches(batched3, batches, DRAIN_SIZE, bulk, duration));
+        std::cout << "Impl3 " << mode << ": " << duration << "ms" << std::endl;
+    }
+    for (const auto &result : results)
+        ASSERT(result == results.front(), "Batched implementations do not match");
+
+    const std::vector<Operation> updates{ops.begin(), ops.begin() + NUM_OPERATIONS / 10};
+    hara::PriorityQueue1<std::string, int> steady1;
+    std::cout << "Impl1 steady-state update allocations: "
+              << CountUpdateAllocations(steady1, updates) << std::endl;
+
+    hara::PriorityQueue2<std::string, int> steady2;
+    std::cout << "Impl2 steady-state update allocations: "
+              << CountUpdateAllocations(steady2, updates) << std::endl;
+
+    hara::PriorityQueue3<std::string, int> steady3;
+    std::cout << "Impl3 steady-state update allocations: "
+              << CountUpdateAllocations(steady3, updates) << std::endl;
+
+    // decrease-key heavy mix: keys mostly move towards the top, with occasional pops
+    std::vector<int> priority(NUM_KEYS, 0);
+    std::uniform_int_distribution<> mix_dis{0, 99};
+    std::uniform_int_distribution<> delta_dis{1, 1000};
+    std::vector<Operation> increases;
+    increases.reserve(NUM_OPERATIONS);
+    for (int i = 0; i < NUM_OPERATIONS; ++i) {
+        const auto idx = idx_dis(gen) % NUM_KEYS;
+        const auto mix = mix_dis(gen);
+        const int op = mix < 90 ? INSERT : mix < 95 ? TOP : POP;
+        if (op != POP) priority[idx] += delta_dis(gen);
+        increases.emplace_back(op, idx, priority[idx]);
+    }
+
+    hara::PriorityQueue1<std::string, int> increase1;
+    auto increase_result1 = PerformOperations(increase1, increases, duration);
+    std::cout << "Impl1 decrease-key: " << duration << "ms" << std::endl;
+
+    hara::PriorityQueue2<std::string, int> increase2;
+    auto increase_result2 = PerformOperations(increase2, increases, duration);
+    std::cout << "Impl2 decrease-key: " << duration << "ms" << std::endl;
+
+    hara::PriorityQueue3<std::string, int> increase3;
+    auto increase_result3 = PerformOperations(increase3, increases, duration);
+    std::cout << "Impl3 decrease-key: " << duration << "ms" << std::endl;
+
+    ASSERT(increase_result1 == increase_result2, "Decrease-key implementations do not match");
+    ASSERT(increase_result1 == increase_result3, "Decrease-key implementations do not match");
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include <iostream>
+#include "hara/Input.h"
+#include "hara/Output.h"
+#include "hara/ExternalSort.h"
+
+int Usage(const char *program) {
+    std::cerr << "Usage: " << program << " [OPTIONS] [INPUT [OUTPUT]]" << std::endl;
+    std::cerr << "\t--memory MB: approximate memory for lines held at once (default 256)" << std::endl;
+    std::cerr << "\t--threads N: number of threads sorting each chunk (default 1)" << std::endl;
+    std::cerr << "\t--unique: print each distinct line once" << std::endl;
+    std::cerr << "\t--count: print each distinct line once, prefixed by its count and a tab" << std::endl;
+    std::cerr << "\t--tmpdir DIR: where to spill sorted runs (default /tmp)" << std::endl;
+    std::cerr << "\tINPUT: file to sort; use '-' or omit to read from stdin" << std::endl;
+    std::cerr << "\tOUTPUT: output file to print result; use '-' or omit to print to stdout" << std::endl;
+    return EXIT_FAILURE;
+}
+
+/**
+ * sort lines byte-wise, like `LC_ALL=C sort`, spilling to disk beyond the memory limit
+ */
+int main(int argc, const char** argv) {
+    hara::ExternalSort::Options options;
+    std::vector<std::string> args;
+    for (int idx = 1; idx < argc; ++idx) {
+        const std::string arg{argv[idx]};
+        if (arg == "--unique") {
+            options.unique = true;
+        } else if (arg == "--count") {
+            options.count = true;
+        } else if (arg == "--memory" || arg == "--threads" || arg == "--tmpdir") {
+            if (++idx == argc) return Usage(argv[0]);
+            if (arg == "--memory") options.memory_limit = std::stoul(argv[idx]) << 20u;
+            else if (arg == "--threads") options.num_threads = std::stoul(argv[idx]);
+            else options.tmpdir = argv[idx];
+        } else if (arg.size() > 1 && arg[0] == '-' && arg[1] == '-') {
+            return Usage(argv[0]);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() > 2) return Usage(argv[0]);
+
+    hara::Input input{args.size() >= 1 ? args[0] : "-"};
+    hara::Output output{args.size() == 2 ? args[1] : "-"};
+    hara::ExternalSort{options}.Run(input, output);
+    output.Close();
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <iostream>
+#include "hara/Input.h"
+#include "hara/Output.h"
+#include "hara/String.h"
+#include "hara/TopK.h"
+
+/**
+ * Count tokens in K slots only (Space-Saving): a token that is not resident takes over
+ * the least frequent slot with that count plus one, so counts are upper bounds
+ * @return whether any token was admitted that way
+ */
+bool count(const std::string &text, hara::TopK<std::string, size_t> &top) {
+    hara::Input input{text};
+    std::string line;
+    bool estimated = false;
+    while (input.GetLine(line)) {
+        for (auto &token : hara::String::Split(line)) {
+            size_t n = 1;
+            if (top.Contain(token)) {
+                n = top.Peek(token) + 1;
+            } else if (top.Full()) {
+                n = top.Min().second + 1;
+                estimated = true;
+            }
+            // counts only grow, so TopK keeps every resident token
+            top.InsertOrUpdate({std::move(token), n});
+        }
+    }
+    return estimated;
+}
+
+/**
+ * topk K [filename1 filename2 ...]
+ * print the K most frequent tokens with their counts, most frequent first, in memory bounded by K
+ * Once more than K distinct tokens are seen, counts may exceed the true ones by up to
+ * the smallest count printed; a note on stderr tells whether they are exact
+ * If no filename is provided, read from stdin
+ */
+int main(int argc, const char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " K [filename1 filename2 ...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    hara::TopK<std::string, size_t> top{std::stoul(argv[1])};
+    bool estimated = false;
+    if (argc == 2)
+        estimated = count("-", top);
+    for (int idx = 2; idx < argc; ++idx)
+        estimated = count(argv[idx], top) || estimated;
+
+    hara::Output output{"-"};
+    for (const auto &pair : top.Sorted())
+        output << pair.first << '\t' << pair.second << '\n';
+    output.Close();
+
+    if (top.Exact() && !estimated)
+        std::cerr << "exact counts" << std::endl;
+    else
+        std::cerr << "approximate counts, at most " << top.Min().second << " above the true ones" << std::endl;
+
+    return 0;
+}
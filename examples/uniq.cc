@@ -0,0 +1,47 @@
+#include <iostream>
+#include "hara/Dedup.h"
+#include "hara/Input.h"
+#include "hara/Output.h"
+
+int Usage(const char *program) {
+    std::cerr << "Usage: " << program << " [--approximate MB] [--stats] [filename1 filename2 ...]" << std::endl;
+    std::cerr << "\t--approximate MB: remember lines in a Bloom filter of MB megabytes" << std::endl;
+    std::cerr << "\t--stats: report counts and the estimated false positive rate to stderr" << std::endl;
+    return EXIT_FAILURE;
+}
+
+/**
+ * uniq [--approximate MB] [--stats] [filename1 filename2 ...]
+ * print the first occurrence of every line, in input order, without sorting
+ * If no filename is provided, read from stdin
+ */
+int main(int argc, const char** argv) {
+    hara::Dedup::Options options;
+    bool stats = false;
+    int arg = 1;
+    for (; arg < argc && std::string{argv[arg]}.compare(0, 2, "--") == 0; ++arg) {
+        const std::string option{argv[arg]};
+        if (option == "--approximate" && arg + 1 < argc) options.filter_bytes = std::stoul(argv[++arg]) << 20u;
+        else if (option == "--stats") stats = true;
+        else return Usage(argv[0]);
+    }
+
+    hara::Dedup dedup{options};
+    hara::Output output{"-"};
+    if (arg == argc) {
+        hara::Input input{"-"};
+        dedup.Run(input, output);
+    }
+    for (; arg < argc; ++arg) {
+        hara::Input input{argv[arg]};
+        dedup.Run(input, output);
+    }
+
+    if (stats) {
+        std::cerr << "lines: " << dedup.NumLines() << '\n'
+                  << "unique: " << dedup.NumUnique() << '\n'
+                  << "memory bytes: " << dedup.MemoryUsage() << '\n'
+                  << "estimated false positive rate: " << dedup.FalsePositiveRate() << std::endl;
+    }
+    return 0;
+}
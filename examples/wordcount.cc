@@ -0,0 +1,45 @@
+#include <iostream>
+#include "hara/Input.h"
+#include "hara/Output.h"
+#include "hara/WordCount.h"
+
+int Usage(const char *program) {
+    std::cerr << "Usage: " << program << " [--threads N] [--top N] [filename1 filename2 ...]" << std::endl;
+    std::cerr << "\t--threads N: number of counting threads (default 1)" << std::endl;
+    std::cerr << "\t--top N: only print the N most frequent tokens" << std::endl;
+    return EXIT_FAILURE;
+}
+
+/**
+ * wordcount [--threads N] [--top N] [filename1 filename2 ...]
+ * print every whitespace-separated token with its count, most frequent first
+ * If no filename is provided, read from stdin
+ */
+int main(int argc, const char** argv) {
+    size_t num_threads = 1;
+    size_t top = SIZE_MAX;
+    int arg = 1;
+    for (; arg < argc && std::string{argv[arg]}.compare(0, 2, "--") == 0; arg += 2) {
+        const std::string option{argv[arg]};
+        if (arg + 1 == argc) return Usage(argv[0]);
+        if (option == "--threads") num_threads = std::stoul(argv[arg + 1]);
+        else if (option == "--top") top = std::stoul(argv[arg + 1]);
+        else return Usage(argv[0]);
+    }
+
+    hara::WordCount counter{num_threads};
+    if (arg == argc) {
+        hara::Input input{"-"};
+        counter.Add(input);
+    }
+    for (; arg < argc; ++arg) {
+        hara::Input input{argv[arg]};
+        counter.Add(input);
+    }
+
+    hara::Output output{"-"};
+    for (const auto &entry : counter.Table().Sorted(top))
+        output << entry.first << '\t' << entry.second << '\n';
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef HARA_ARENA_H
+#define HARA_ARENA_H
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "StringView.h"
+
+namespace hara {
+
+/**
+ * Bump allocator for bytes that live as long as the arena
+ * Memory is taken from the global allocator in blocks and only released all at once;
+ * Reset() rewinds over the blocks so they are reused instead of released
+ */
+class Arena {
+public:
+    explicit Arena(size_t block_size = size_t{64} << 10u)
+            : block_size{block_size}, used{0}, available{0}, next{0} {}
+
+    Arena(Arena &&) = default;
+
+    Arena &operator=(Arena &&) = default;
+
+    char *Allocate(size_t size) {
+        if (size > available) NextBlock(size);
+        auto p = head;
+        head += size;
+        available -= size;
+        return p;
+    }
+
+    /**
+     * Copy the bytes into the arena
+     * @return view of the copy
+     */
+    StringView Store(StringView s) {
+        auto p = Allocate(s.size());
+        if (!s.empty()) std::memcpy(p, s.data(), s.size());
+        return {p, s.size()};
+    }
+
+    /**
+     * Forget everything stored so far, invalidating its views; keeps the blocks for reuse
+     */
+    void Reset() {
+        next = 0;
+        available = 0;
+        head = nullptr;
+    }
+
+    /**
+     * bytes taken from the global allocator
+     */
+    size_t Capacity() const { return used; }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    /**
+     * Move head to the next kept block large enough for size, or to a new one
+     */
+    void NextBlock(size_t size) {
+        for (; next < blocks.size(); ++next) {
+            if (blocks[next].size < size) continue;
+            head = blocks[next].data.get();
+            available = blocks[next++].size;
+            return;
+        }
+        const auto size_of_block = std::max(size, block_size);
+        blocks.push_back({std::unique_ptr<char[]>{new char[size_of_block]}, size_of_block});
+        next = blocks.size();
+        used += size_of_block;
+        available = size_of_block;
+        head = blocks.back().data.get();
+    }
+
+    size_t block_size;
+    std::vector<Block> blocks;
+    size_t used;
+    size_t available;
+    // first block not handed out since the last Reset
+    size_t next;
+    char *head = nullptr;
+};
+
+}
+
+#endif //HARA_ARENA_H
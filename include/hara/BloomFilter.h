@@ -0,0 +1,117 @@
+#ifndef HARA_BLOOM_FILTER_H
+#define HARA_BLOOM_FILTER_H
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Macros.h"
+
+namespace hara {
+
+/**
+ * Blocked Bloom filter over 64-bit fingerprints with a fixed memory budget
+ *
+ * Every fingerprint sets num_hashes bits within a single 512-bit block (one cache line),
+ * so a lookup costs one cache miss instead of num_hashes;
+ * lookups may return false positives but never false negatives
+ */
+class BloomFilter {
+public:
+    /**
+     * @param memory_bytes rounded down to whole 64-byte blocks, at least one
+     * @param num_hashes bits per fingerprint; 7 is optimal around 10 bits per inserted element
+     */
+    explicit BloomFilter(size_t memory_bytes, size_t num_hashes = 7)
+            : blocks(std::max<size_t>(1, memory_bytes / sizeof(Block))), num_hashes{num_hashes} {
+        ASSERT(num_hashes > 0, "At least one hash is needed");
+    }
+
+    /**
+     * @return false if every bit was set already, i.e. fingerprint was possibly inserted before
+     * Complexity: O(num_hashes)
+     */
+    bool Insert(uint64_t fingerprint) {
+        auto &block = blocks[BlockIndex(fingerprint)];
+        bool inserted = false;
+        ForEachBit(fingerprint, [&block, &inserted](size_t bit) {
+            auto &word = block.words[bit / 64];
+            const auto mask = uint64_t{1} << (bit % 64);
+            inserted |= !(word & mask);
+            word |= mask;
+        });
+        return inserted;
+    }
+
+    bool Contain(uint64_t fingerprint) const {
+        const auto &block = blocks[BlockIndex(fingerprint)];
+        bool contained = true;
+        ForEachBit(fingerprint, [&block, &contained](size_t bit) {
+            contained &= (block.words[bit / 64] >> (bit % 64)) & 1u;
+        });
+        return contained;
+    }
+
+    /**
+     * Probability that a fingerprint never inserted is reported as contained,
+     * estimated from how full every block is
+     * Complexity: O(memory)
+     */
+    double FalsePositiveRate() const {
+        double sum = 0;
+        for (const auto &block : blocks) {
+            size_t bits = 0;
+            for (auto word : block.words) bits += std::bitset<64>(word).count();
+            sum += std::pow(static_cast<double>(bits) / BLOCK_BITS, static_cast<double>(num_hashes));
+        }
+        return sum / blocks.size();
+    }
+
+    size_t MemoryUsage() const { return blocks.size() * sizeof(Block); }
+
+private:
+    static const size_t BLOCK_BITS = 512;
+
+    struct Block {
+        uint64_t words[BLOCK_BITS / 64] = {};
+    };
+
+    /**
+     * High 32 bits of the fingerprint scaled to the number of blocks
+     */
+    size_t BlockIndex(uint64_t fingerprint) const {
+        return static_cast<size_t>(((fingerprint >> 32u) * blocks.size()) >> 32u);
+    }
+
+    /**
+     * Bits within the block, 9 bits of a remixed fingerprint each
+     * (independent positions; double hashing within 512 bits allows too few distinct patterns)
+     * Every 7 bits a fresh remix of the original fingerprint takes over
+     */
+    template<typename Function>
+    void ForEachBit(uint64_t fingerprint, Function function) const {
+        uint64_t bits = 0;
+        for (size_t i = 0; i < num_hashes; ++i, bits >>= 9u) {
+            if (i % 7 == 0) bits = Remix(fingerprint, i / 7);
+            function(static_cast<size_t>(bits % BLOCK_BITS));
+        }
+    }
+
+    /**
+     * splitmix64 finalizer of the fingerprint offset by round
+     */
+    static uint64_t Remix(uint64_t x, size_t round) {
+        x += (round + 1) * 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30u)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27u)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31u);
+    }
+
+    std::vector<Block> blocks;
+    const size_t num_hashes;
+};
+
+}
+
+#endif //HARA_BLOOM_FILTER_H
@@ -0,0 +1,64 @@
+#ifndef HARA_BOUNDED_QUEUE_H
+#define HARA_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace hara {
+
+/**
+ * Blocking multi-producer multi-consumer FIFO with a fixed capacity
+ * Once closed, Push fails and Pop drains what is left
+ */
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity{capacity}, closed{false} {}
+
+    /**
+     * Block while full
+     * @return false if the queue was closed
+     */
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock{mutex};
+        not_full.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    /**
+     * Block while empty
+     * @return false once the queue is closed and drained
+     */
+    bool Pop(T &item) {
+        std::unique_lock<std::mutex> lock{mutex};
+        not_empty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock{mutex};
+        closed = true;
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+private:
+    const size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+};
+
+}
+
+#endif //HARA_BOUNDED_QUEUE_H
@@ -0,0 +1,550 @@
+#ifndef HARA_COMPRESSION_H
+#define HARA_COMPRESSION_H
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+
+#ifdef HARA_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HARA_ZSTD
+#include <zstd.h>
+#endif
+
+namespace hara {
+
+/**
+ * Streaming gzip / zstd support for Input and Output
+ *
+ * Each codec is compiled in only if its library was found at build time (HARA_ZLIB, HARA_ZSTD);
+ * opening a stream that needs a missing codec throws
+ */
+enum class Codec {
+    None, Gzip, Zstd
+};
+
+/**
+ * Detect a codec from the first bytes of a stream
+ */
+inline Codec CodecFromMagic(const char *data, size_t size) {
+    if (size >= 2 && std::memcmp(data, "\x1f\x8b", 2) == 0) return Codec::Gzip;
+    if (size >= 4 && std::memcmp(data, "\x28\xb5\x2f\xfd", 4) == 0) return Codec::Zstd;
+    return Codec::None;
+}
+
+/**
+ * Detect a codec from a .gz or .zst extension
+ */
+inline Codec CodecFromPath(const std::string &path) {
+    auto ends_with = [&path](const std::string &suffix) {
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (ends_with(".gz")) return Codec::Gzip;
+    if (ends_with(".zst")) return Codec::Zstd;
+    return Codec::None;
+}
+
+/**
+ * Source of plain bytes
+ */
+class Decoder {
+public:
+    virtual ~Decoder() = default;
+
+    /**
+     * Fill up to size bytes
+     * @return number of bytes written, 0 once the stream is exhausted
+     */
+    virtual size_t Read(char *data, size_t size) = 0;
+
+protected:
+    /**
+     * @param prefix bytes already consumed from source while detecting the codec
+     */
+    Decoder(std::streambuf *source, std::string prefix) : source{source}, prefix{std::move(prefix)} {}
+
+    /**
+     * Raw bytes of the source, prefix first
+     */
+    size_t ReadSource(char *data, size_t size) {
+        if (!prefix.empty()) {
+            const auto n = std::min(size, prefix.size());
+            std::memcpy(data, prefix.data(), n);
+            prefix.erase(0, n);
+            return n;
+        }
+        return static_cast<size_t>(source->sgetn(data, static_cast<std::streamsize>(size)));
+    }
+
+    static const size_t CHUNK_SIZE = 1u << 16u;
+
+private:
+    std::streambuf *const source;
+    std::string prefix;
+};
+
+/**
+ * Sink of plain bytes
+ */
+class Encoder {
+public:
+    virtual ~Encoder() = default;
+
+    virtual void Write(const char *data, size_t size) = 0;
+
+    /**
+     * Write the trailer; called once, after which Write is not allowed
+     */
+    virtual void Finish() = 0;
+
+    /**
+     * Flush what was handed to the sink so far
+     * @return false if the sink failed to
+     */
+    bool FlushSink() { return sink->pubsync() == 0; }
+
+protected:
+    explicit Encoder(std::streambuf *sink) : sink{sink} {}
+
+    void WriteSink(const char *data, size_t size) {
+        if (sink->sputn(data, static_cast<std::streamsize>(size)) != static_cast<std::streamsize>(size))
+            throw std::runtime_error("Cannot write compressed output");
+    }
+
+    static const size_t CHUNK_SIZE = 1u << 16u;
+
+    std::streambuf *const sink;
+};
+
+#ifdef HARA_ZLIB
+
+/**
+ * gzip or zlib stream; concatenated members (pigz, bgzip) are read through
+ */
+class GzipDecoder : public Decoder {
+public:
+    GzipDecoder(std::streambuf *source, std::string prefix)
+            : Decoder{source, std::move(prefix)}, buffer(CHUNK_SIZE), done{false} {
+        std::memset(&stream, 0, sizeof(stream));
+        // 32: detect the gzip or zlib header
+        if (inflateInit2(&stream, 15 + 32) != Z_OK) throw std::runtime_error("Cannot initialize zlib");
+    }
+
+    ~GzipDecoder() override { inflateEnd(&stream); }
+
+    size_t Read(char *data, size_t size) override {
+        stream.next_out = reinterpret_cast<Bytef *>(data);
+        stream.avail_out = static_cast<uInt>(size);
+        while (stream.avail_out > 0 && !done) {
+            if (stream.avail_in == 0) {
+                stream.avail_in = static_cast<uInt>(ReadSource(buffer.data(), buffer.size()));
+                stream.next_in = reinterpret_cast<Bytef *>(buffer.data());
+                if (stream.avail_in == 0) {
+                    // total_in is reset at the end of every member
+                    if (stream.total_in > 0) throw std::runtime_error("Truncated gzip input");
+                    done = true;
+                    break;
+                }
+            }
+            const auto ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                inflateReset(&stream);
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string{"Corrupted gzip input: "} + (stream.msg ? stream.msg : "?"));
+            }
+        }
+        return size - stream.avail_out;
+    }
+
+private:
+    z_stream stream;
+    std::vector<char> buffer;
+    bool done;
+};
+
+class GzipEncoder : public Encoder {
+public:
+    explicit GzipEncoder(std::streambuf *sink, int level = Z_DEFAULT_COMPRESSION)
+            : Encoder{sink}, buffer(CHUNK_SIZE) {
+        std::memset(&stream, 0, sizeof(stream));
+        // 16: gzip header instead of zlib
+        if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("Cannot initialize zlib");
+    }
+
+    ~GzipEncoder() override { deflateEnd(&stream); }
+
+    void Write(const char *data, size_t size) override {
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        stream.avail_in = static_cast<uInt>(size);
+        Deflate(Z_NO_FLUSH);
+    }
+
+    void Finish() override { Deflate(Z_FINISH); }
+
+private:
+    void Deflate(int flush) {
+        int ret;
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+            stream.avail_out = static_cast<uInt>(buffer.size());
+            ret = deflate(&stream, flush);
+            WriteSink(buffer.data(), buffer.size() - stream.avail_out);
+        } while (stream.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+    }
+
+    z_stream stream;
+    std::vector<char> buffer;
+};
+
+#endif
+
+#ifdef HARA_ZSTD
+
+/**
+ * zstd stream; concatenated frames are read through
+ */
+class ZstdDecoder : public Decoder {
+public:
+    ZstdDecoder(std::streambuf *source, std::string prefix)
+            : Decoder{source, std::move(prefix)}, stream{ZSTD_createDStream()},
+              buffer(ZSTD_DStreamInSize()), input{buffer.data(), 0, 0}, in_frame{false}, done{false} {
+        if (!stream) throw std::runtime_error("Cannot initialize zstd");
+        ZSTD_initDStream(stream);
+    }
+
+    ~ZstdDecoder() override { ZSTD_freeDStream(stream); }
+
+    size_t Read(char *data, size_t size) override {
+        ZSTD_outBuffer output{data, size, 0};
+        while (output.pos < output.size && !done) {
+            if (input.pos == input.size) {
+                input.size = ReadSource(buffer.data(), buffer.size());
+                input.pos = 0;
+                if (input.size == 0) {
+                    if (in_frame) throw std::runtime_error("Truncated zstd input");
+                    done = true;
+                    break;
+                }
+            }
+            const auto ret = ZSTD_decompressStream(stream, &output, &input);
+            // 0 once a frame is complete and flushed
+            in_frame = ret != 0;
+            if (ZSTD_isError(ret))
+                throw std::runtime_error(std::string{"Corrupted zstd input: "} + ZSTD_getErrorName(ret));
+        }
+        return output.pos;
+    }
+
+private:
+    ZSTD_DStream *const stream;
+    std::vector<char> buffer;
+    ZSTD_inBuffer input;
+    bool in_frame;
+    bool done;
+};
+
+class ZstdEncoder : public Encoder {
+public:
+    explicit ZstdEncoder(std::streambuf *sink, int level = 3)
+            : Encoder{sink}, stream{ZSTD_createCStream()}, buffer(ZSTD_CStreamOutSize()) {
+        if (!stream) throw std::runtime_error("Cannot initialize zstd");
+        ZSTD_initCStream(stream, level);
+    }
+
+    ~ZstdEncoder() override { ZSTD_freeCStream(stream); }
+
+    void Write(const char *data, size_t size) override {
+        ZSTD_inBuffer input{data, size, 0};
+        while (input.pos < input.size) {
+            ZSTD_outBuffer output{buffer.data(), buffer.size(), 0};
+            Check(ZSTD_compressStream(stream, &output, &input));
+            WriteSink(buffer.data(), output.pos);
+        }
+    }
+
+    void Finish() override {
+        size_t remaining;
+        do {
+            ZSTD_outBuffer output{buffer.data(), buffer.size(), 0};
+            remaining = Check(ZSTD_endStream(stream, &output));
+            WriteSink(buffer.data(), output.pos);
+        } while (remaining > 0);
+    }
+
+private:
+    static size_t Check(size_t ret) {
+        if (ZSTD_isError(ret)) throw std::runtime_error(std::string{"zstd error: "} + ZSTD_getErrorName(ret));
+        return ret;
+    }
+
+    ZSTD_CStream *const stream;
+    std::vector<char> buffer;
+};
+
+#endif
+
+/**
+ * Input buffer fed by a Decoder running on a helper thread,
+ * so that decompression overlaps with parsing on the reading thread
+ *
+ * A fixed set of blocks is recycled between the two threads;
+ * a decoding error ends the stream and is rethrown by the read that reaches the end
+ */
+class DecodingBuf : public std::streambuf {
+public:
+    explicit DecodingBuf(std::unique_ptr<Decoder> decoder, size_t block_size = 1u << 18u, size_t num_blocks = 4)
+            : decoder{std::move(decoder)}, blocks(num_blocks, std::vector<char>(block_size)),
+              sizes(num_blocks, 0), free{num_blocks}, full{num_blocks}, current{num_blocks} {
+        for (size_t idx = 0; idx < num_blocks; ++idx) free.Push(idx);
+        helper = std::thread{[this]() { Decode(); }};
+    }
+
+    ~DecodingBuf() override {
+        free.Close();
+        full.Close();
+        helper.join();
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        if (current < blocks.size()) free.Push(current);
+        current = blocks.size();
+        size_t idx;
+        if (!full.Pop(idx)) {
+            if (error) std::rethrow_exception(error);
+            return traits_type::eof();
+        }
+        current = idx;
+        auto begin = blocks[idx].data();
+        setg(begin, begin, begin + sizes[idx]);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    /**
+     * Fill free blocks until the end of the stream, then close the full queue
+     */
+    void Decode() {
+        size_t idx;
+        while (free.Pop(idx)) {
+            auto &block = blocks[idx];
+            auto &size = sizes[idx];
+            size = 0;
+            try {
+                while (size < block.size()) {
+                    const auto n = decoder->Read(block.data() + size, block.size() - size);
+                    if (n == 0) break;
+                    size += n;
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (size > 0) full.Push(idx);
+            if (size < block.size()) break;
+        }
+        full.Close();
+    }
+
+    std::unique_ptr<Decoder> decoder;
+    std::vector<std::vector<char>> blocks;
+    std::vector<size_t> sizes;
+    BoundedQueue<size_t> free, full;
+    // block being read, blocks.size() if none
+    size_t current;
+    std::exception_ptr error;
+    std::thread helper;
+};
+
+/**
+ * Plain source whose first bytes were consumed while detecting the codec and could not be
+ * pushed back, e.g. a pipe; replays them, then reads the source on the calling thread
+ */
+class PushbackBuf : public std::streambuf {
+public:
+    PushbackBuf(std::streambuf *source, std::string prefix, size_t buffer_size = 1u << 16u)
+            : source{source}, prefix{std::move(prefix)}, buffer(buffer_size) {
+        setg(&this->prefix[0], &this->prefix[0], &this->prefix[0] + this->prefix.size());
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        const auto n = source->sgetn(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (n <= 0) return traits_type::eof();
+        setg(buffer.data(), buffer.data(), buffer.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    /**
+     * Large reads skip the buffer once what it holds is used up
+     */
+    std::streamsize xsgetn(char *data, std::streamsize size) override {
+        const auto buffered = std::min<std::streamsize>(size, egptr() - gptr());
+        std::memcpy(data, gptr(), static_cast<size_t>(buffered));
+        gbump(static_cast<int>(buffered));
+        if (buffered == size) return size;
+        if (size - buffered >= static_cast<std::streamsize>(buffer.size()))
+            return buffered + source->sgetn(data + buffered, size - buffered);
+        return buffered + std::streambuf::xsgetn(data + buffered, size - buffered);
+    }
+
+private:
+    std::streambuf *const source;
+    std::string prefix;
+    std::vector<char> buffer;
+};
+
+/**
+ * Output buffer flushed through an Encoder
+ * Close() writes the trailer and reports any error; otherwise the destructor does, silently.
+ * sync() hands buffered bytes to the encoder and flushes the sink but does not end the compressed block
+ */
+class EncodingBuf : public std::streambuf {
+public:
+    explicit EncodingBuf(std::unique_ptr<Encoder> encoder, size_t buffer_size = 1u << 16u)
+            : encoder{std::move(encoder)}, buffer(buffer_size), closed{false} {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    ~EncodingBuf() override {
+        if (closed) return;
+        try {
+            Close();
+        } catch (...) {
+            // last resort; whoever needs to know calls Close() first
+        }
+    }
+
+    /**
+     * Write out buffered bytes and the trailer, then flush the sink; further writes fail
+     * throws exception if any of it fails
+     */
+    void Close() {
+        if (closed) return;
+        closed = true;
+        Drain();
+        encoder->Finish();
+        if (!encoder->FlushSink()) throw std::runtime_error("Cannot flush compressed output");
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (closed) return traits_type::eof();
+        Drain();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        if (closed) return 0;
+        Drain();
+        return encoder->FlushSink() ? 0 : -1;
+    }
+
+private:
+    void Drain() {
+        encoder->Write(pbase(), static_cast<size_t>(pptr() - pbase()));
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    std::unique_ptr<Encoder> encoder;
+    std::vector<char> buffer;
+    bool closed;
+};
+
+inline void RequireCodec(Codec codec) {
+#ifndef HARA_ZLIB
+    if (codec == Codec::Gzip) throw std::runtime_error("gzip stream but hara was built without zlib");
+#endif
+#ifndef HARA_ZSTD
+    if (codec == Codec::Zstd) throw std::runtime_error("zstd stream but hara was built without zstd");
+#endif
+    (void) codec;
+}
+
+/**
+ * Wrap source in a decoding buffer if it starts with gzip or zstd magic bytes
+ * Reads only as many bytes as match a magic, so a plain pipe is never blocked on
+ * for more than its first byte unless it starts like a compressed stream
+ * @return nullptr if source is plain and should be read directly
+ */
+inline std::unique_ptr<std::streambuf> OpenDecoding(std::streambuf *source) {
+    typedef std::char_traits<char> traits;
+    const auto first = source->sgetc();
+    if (first != 0x1f && first != 0x28) return nullptr;
+
+    const std::string magic{first == 0x1f ? std::string{"\x1f\x8b", 2} : std::string{"\x28\xb5\x2f\xfd", 4}};
+    const auto pos = source->pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+    std::string prefix;
+    for (auto c = first; c == traits::to_int_type(magic[prefix.size()]); c = source->sgetc()) {
+        prefix.push_back(traits::to_char_type(c));
+        source->sbumpc();
+        if (prefix.size() == magic.size()) break;
+    }
+    const auto codec = prefix.size() == magic.size() ? CodecFromMagic(prefix.data(), prefix.size()) : Codec::None;
+    RequireCodec(codec);
+
+    std::unique_ptr<Decoder> decoder;
+    switch (codec) {
+#ifdef HARA_ZLIB
+        case Codec::Gzip:
+            decoder.reset(new GzipDecoder{source, std::move(prefix)});
+            break;
+#endif
+#ifdef HARA_ZSTD
+        case Codec::Zstd:
+            decoder.reset(new ZstdDecoder{source, std::move(prefix)});
+            break;
+#endif
+        default:
+            // plain after all; the byte that did not match is still in source
+            if (prefix.empty()) return nullptr;
+            if (pos != std::streampos(std::streamoff(-1)) &&
+                source->pubseekpos(pos, std::ios_base::in) == pos)
+                return nullptr;
+            return std::unique_ptr<std::streambuf>{new PushbackBuf{source, std::move(prefix)}};
+    }
+    return std::unique_ptr<std::streambuf>{new DecodingBuf{std::move(decoder)}};
+}
+
+/**
+ * Wrap sink in an encoding buffer for the given codec
+ * @return nullptr for Codec::None
+ */
+inline std::unique_ptr<EncodingBuf> OpenEncoding(std::streambuf *sink, Codec codec) {
+    RequireCodec(codec);
+    std::unique_ptr<Encoder> encoder;
+    switch (codec) {
+#ifdef HARA_ZLIB
+        case Codec::Gzip:
+            encoder.reset(new GzipEncoder{sink});
+            break;
+#endif
+#ifdef HARA_ZSTD
+        case Codec::Zstd:
+            encoder.reset(new ZstdEncoder{sink});
+            break;
+#endif
+        default:
+            (void) sink;
+            return nullptr;
+    }
+    return std::unique_ptr<EncodingBuf>{new EncodingBuf{std::move(encoder)}};
+}
+
+}
+
+#endif //HARA_COMPRESSION_H
@@ -0,0 +1,267 @@
+#ifndef HARA_CONCURRENT_PRIORITY_QUEUE_H
+#define HARA_CONCURRENT_PRIORITY_QUEUE_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "PriorityQueue.h"
+#include "Macros.h"
+
+namespace hara {
+
+/**
+ * Thread-safe priority queue over sharded single-threaded backends
+ *
+ * Every key lives in exactly one shard picked by its hash,
+ * so InsertOrUpdate / Erase / Contain / Peek only lock that shard.
+ *
+ * Strict: every shard publishes a snapshot of its top; Pop picks the best shard from the snapshots
+ *         and locks only that one, retrying if its top changed in between.
+ *         Pops are exact unless they race with an update of another shard;
+ *         after a few failed attempts Pop locks every shard in index order
+ * Relaxed: MultiQueue-style; Pop compares the tops of two random shards
+ *          and returns the better one, trading exact order for throughput.
+ *          After a few failed attempts it falls back to a locked scan of the shards
+ *
+ * @tparam Impl single-threaded backend, e.g. PriorityQueueImpl2<K, V>
+ */
+template<typename Impl>
+class ConcurrentPriorityQueue {
+public:
+    using K = typename Impl::Key;
+    using V = typename Impl::Value;
+
+    enum class Ordering {
+        Strict,
+        Relaxed
+    };
+
+    /**
+     * @param num_threads expected number of concurrent callers
+     * @param shards_per_thread c in c * num_threads shards
+     */
+    explicit ConcurrentPriorityQueue(Ordering ordering = Ordering::Strict,
+                                     size_t num_threads = std::thread::hardware_concurrency(),
+                                     size_t shards_per_thread = 2)
+            : ordering{ordering},
+              num_shards{std::max<size_t>(1, num_threads) * std::max<size_t>(1, shards_per_thread)},
+              shards{new Shard[num_shards]},
+              size{0} {}
+
+    // shards hold mutexes
+    ConcurrentPriorityQueue(const ConcurrentPriorityQueue &) = delete;
+
+    ConcurrentPriorityQueue &operator=(const ConcurrentPriorityQueue &) = delete;
+
+    void InsertOrUpdate(std::pair<K, V> pair) {
+        auto &shard = ShardOf(pair.first);
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        if (!shard.queue.Contain(pair.first)) size.fetch_add(1, std::memory_order_relaxed);
+        shard.queue.InsertOrUpdate(std::move(pair));
+        Publish(shard);
+    }
+
+    void Erase(const K &key) {
+        auto &shard = ShardOf(key);
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        if (!shard.queue.Contain(key)) return;
+        shard.queue.Erase(key);
+        size.fetch_sub(1, std::memory_order_relaxed);
+        Publish(shard);
+    }
+
+    bool Contain(const K &key) const {
+        auto &shard = ShardOf(key);
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        return shard.queue.Contain(key);
+    }
+
+    /**
+     * Returns a copy since the value may change as soon as the shard is unlocked
+     * throws exception if key not found
+     */
+    V Peek(const K &key) const {
+        auto &shard = ShardOf(key);
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        return shard.queue.Peek(key);
+    }
+
+    /**
+     * Remove the top element and hand it over to the caller
+     * @return false if the queue was empty
+     */
+    bool Pop(std::pair<K, V> &top) {
+        return ordering == Ordering::Strict ? PopStrict(top) : PopRelaxed(top);
+    }
+
+    /**
+     * Approximate while other threads are modifying the queue
+     */
+    size_t Size() const { return size.load(std::memory_order_relaxed); }
+
+    bool Empty() const { return Size() == 0; }
+
+    Ordering GetOrdering() const { return ordering; }
+
+    size_t NumShards() const { return num_shards; }
+
+private:
+    // random shard pairs tried by a relaxed pop before scanning every shard
+    static const size_t RELAXED_ATTEMPTS = 8;
+    // snapshot-guided pops tried by a strict pop before locking every shard
+    static const size_t STRICT_ATTEMPTS = 8;
+
+    using Top = std::shared_ptr<const std::pair<K, V>>;
+
+    struct Shard {
+        mutable std::mutex mutex;
+        PriorityQueue<Impl> queue;
+        // strict ordering only: copy of the top, nullptr if empty; written under mutex, read without it
+        Top top;
+        // bumped after every change of top
+        std::atomic<size_t> version{0};
+        // keep neighbouring shards off the same cache line
+        char padding[64];
+    };
+
+    static bool Higher(const std::pair<K, V> &a, const std::pair<K, V> &b) {
+        typename Impl::ValueCompare less;
+        return less(b.second, a.second) || (!less(a.second, b.second) && b.first < a.first);
+    }
+
+    Shard &ShardOf(const K &key) const { return shards[std::hash<K>()(key) % num_shards]; }
+
+    /**
+     * Refresh the snapshot of a strict shard after a change; the caller holds its lock
+     * Allocates only when the top element or its value changed
+     */
+    void Publish(Shard &shard) {
+        if (ordering != Ordering::Strict) return;
+        const auto &published = shard.top;
+        if (shard.queue.Empty()) {
+            if (!published) return;
+            std::atomic_store(&shard.top, Top{});
+        } else {
+            const auto &top = shard.queue.Top();
+            if (published && !Higher(top, *published) && !Higher(*published, top)) return;
+            std::atomic_store(&shard.top, Top{new std::pair<K, V>(top)});
+        }
+        shard.version.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * Pick the best shard from the snapshots and lock only that one;
+     * its version tells whether its top changed since the snapshot was read
+     */
+    bool PopStrict(std::pair<K, V> &top) {
+        for (size_t attempt = 0; attempt < STRICT_ATTEMPTS; ++attempt) {
+            Shard *best = nullptr;
+            Top best_top;
+            size_t best_version = 0;
+            for (size_t idx = 0; idx < num_shards; ++idx) {
+                auto &shard = shards[idx];
+                // version first: a snapshot published after it comes with a newer version
+                const auto version = shard.version.load(std::memory_order_acquire);
+                auto snapshot = std::atomic_load(&shard.top);
+                if (snapshot && (!best || Higher(*snapshot, *best_top))) {
+                    best = &shard;
+                    best_top = std::move(snapshot);
+                    best_version = version;
+                }
+            }
+            if (!best) return false;
+            std::lock_guard<std::mutex> lock{best->mutex};
+            if (best->version.load(std::memory_order_relaxed) != best_version) continue;
+            PopFrom(*best, top);
+            return true;
+        }
+        return PopLocked(top);
+    }
+
+    /**
+     * Lock every shard in index order, which is deadlock free since
+     * every other path only ever try_locks or locks in index order as well
+     */
+    bool PopLocked(std::pair<K, V> &top) {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(num_shards);
+        Shard *best = nullptr;
+        for (size_t idx = 0; idx < num_shards; ++idx) {
+            locks.emplace_back(shards[idx].mutex);
+            auto &queue = shards[idx].queue;
+            if (!queue.Empty() && (!best || Higher(queue.Top(), best->queue.Top()))) best = &shards[idx];
+        }
+        if (!best) return false;
+        PopFrom(*best, top);
+        return true;
+    }
+
+    bool PopRelaxed(std::pair<K, V> &top) {
+        static thread_local std::minstd_rand gen{std::random_device{}()};
+        std::uniform_int_distribution<size_t> dis{0, num_shards - 1};
+        for (size_t attempt = 0; attempt < RELAXED_ATTEMPTS && !Empty(); ++attempt) {
+            auto &a = shards[dis(gen)];
+            auto &b = shards[dis(gen)];
+            std::unique_lock<std::mutex> lock_a{a.mutex, std::try_to_lock};
+            if (!lock_a) continue;
+            std::unique_lock<std::mutex> lock_b;
+            if (&a != &b) {
+                lock_b = std::unique_lock<std::mutex>{b.mutex, std::try_to_lock};
+                if (!lock_b) continue;
+            }
+            Shard *best = a.queue.Empty() ? nullptr : &a;
+            if (!b.queue.Empty() && (!best || Higher(b.queue.Top(), best->queue.Top()))) best = &b;
+            if (!best) continue;
+            PopFrom(*best, top);
+            return true;
+        }
+        return PopScan(top);
+    }
+
+    /**
+     * Visit the shards in index order holding at most two locks: the current shard
+     * and the one with the best top so far, which is popped at the end
+     * Elements inserted behind the scan may be missed, so the result is not strict
+     */
+    bool PopScan(std::pair<K, V> &top) {
+        std::unique_lock<std::mutex> best_lock;
+        Shard *best = nullptr;
+        for (size_t idx = 0; idx < num_shards; ++idx) {
+            std::unique_lock<std::mutex> lock{shards[idx].mutex};
+            auto &queue = shards[idx].queue;
+            if (!queue.Empty() && (!best || Higher(queue.Top(), best->queue.Top()))) {
+                best = &shards[idx];
+                best_lock = std::move(lock);
+            }
+        }
+        if (!best) return false;
+        PopFrom(*best, top);
+        return true;
+    }
+
+    void PopFrom(Shard &shard, std::pair<K, V> &top) {
+        top = shard.queue.Top();
+        shard.queue.Pop();
+        size.fetch_sub(1, std::memory_order_relaxed);
+        Publish(shard);
+    }
+
+    const Ordering ordering;
+    const size_t num_shards;
+    const std::unique_ptr<Shard[]> shards;
+    std::atomic<size_t> size;
+};
+
+template<typename K, typename V, typename C = std::less<V>>
+using ConcurrentPriorityQueue1 = ConcurrentPriorityQueue<PriorityQueueImpl1<K, V, C>>;
+
+template<typename K, typename V, typename C = std::less<V>>
+using ConcurrentPriorityQueue2 = ConcurrentPriorityQueue<PriorityQueueImpl2<K, V, C>>;
+
+}
+
+#endif //HARA_CONCURRENT_PRIORITY_QUEUE_H
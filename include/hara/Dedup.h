@@ -0,0 +1,85 @@
+#ifndef HARA_DEDUP_H
+#define HARA_DEDUP_H
+
+#include <cmath>
+#include <memory>
+#include "BloomFilter.h"
+#include "Fingerprint.h"
+#include "Input.h"
+#include "Output.h"
+#include "StringView.h"
+
+namespace hara {
+
+/**
+ * Streaming line deduplication: the first occurrence of every line is kept, in input order
+ *
+ * Only a 64-bit fingerprint of each distinct line is remembered, in a FingerprintSet (exact up to
+ * fingerprint collisions, 8-16 bytes per distinct line) or in a BloomFilter of fixed size
+ * (approximate: a new line may be dropped as a duplicate with FalsePositiveRate probability)
+ */
+class Dedup {
+public:
+    struct Options {
+        // size of the Bloom filter in bytes for approximate dedup; 0 for exact
+        size_t filter_bytes = 0;
+        size_t num_hashes = 7;
+    };
+
+    explicit Dedup(Options options) : num_lines{0}, num_unique{0} {
+        if (options.filter_bytes) filter.reset(new BloomFilter{options.filter_bytes, options.num_hashes});
+    }
+
+    /**
+     * @return true if line is seen for the first time
+     * Complexity: amortized O(|line|)
+     */
+    bool Insert(StringView line) {
+        ++num_lines;
+        const auto fingerprint = Fingerprint(line);
+        const bool inserted = filter ? filter->Insert(fingerprint) : set.Insert(fingerprint);
+        num_unique += inserted;
+        return inserted;
+    }
+
+    /**
+     * Write the first occurrence of every line of input to output
+     * Lines are read as views, so they are never copied before being written
+     */
+    void Run(Input &input, Output &output) {
+        StringView line;
+        while (input.GetLine(line))
+            if (Insert(line)) output << line << '\n';
+    }
+
+    size_t NumLines() const { return num_lines; }
+
+    /**
+     * lines kept so far
+     */
+    size_t NumUnique() const { return num_unique; }
+
+    /**
+     * Probability that the next new line is dropped as a duplicate
+     * Exact mode: a fingerprint collision, NumUnique / 2^64
+     * Complexity: O(memory) in approximate mode
+     */
+    double FalsePositiveRate() const {
+        return filter ? filter->FalsePositiveRate() : std::ldexp(static_cast<double>(set.Size()), -64);
+    }
+
+    /**
+     * bytes held by the fingerprints
+     */
+    size_t MemoryUsage() const { return filter ? filter->MemoryUsage() : set.MemoryUsage(); }
+
+private:
+    FingerprintSet set;
+    std::unique_ptr<BloomFilter> filter;
+    size_t num_lines;
+    size_t num_unique;
+};
+
+}
+
+#endif //HARA_DEDUP_H
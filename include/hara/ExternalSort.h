@@ -0,0 +1,277 @@
+#ifndef HARA_EXTERNAL_SORT_H
+#define HARA_EXTERNAL_SORT_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "Input.h"
+#include "Output.h"
+#include "PriorityQueue.h"
+#include "Macros.h"
+
+namespace hara {
+
+/**
+ * Sort the lines of an Input that may not fit in memory, byte-wise like `LC_ALL=C sort`
+ *
+ * Lines are read in chunks of about memory_limit bytes; each chunk is sorted
+ * by num_threads threads and spilled as a sorted run to a temporary file.
+ * Runs are then k-way merged through a PriorityQueue keyed by run,
+ * in several passes if there are more than max_fan_in of them.
+ *
+ * Optionally adjacent duplicates are dropped (unique) or counted (count),
+ * during the chunk spills as well as the merge
+ *
+ * Run files are created exclusively (mkstemp) and removed once merged,
+ * or when Run leaves by an exception
+ */
+class ExternalSort {
+public:
+    struct Options {
+        // approximate bytes of lines held in memory at once
+        size_t memory_limit = size_t{256} << 20u;
+        size_t num_threads = 1;
+        // keep one copy of each line
+        bool unique = false;
+        // keep one copy of each line, prefixed by its count and a tab
+        bool count = false;
+        std::string tmpdir = "/tmp";
+        // runs merged at once
+        size_t max_fan_in = 128;
+    };
+
+    explicit ExternalSort(Options options) : options{std::move(options)}, num_runs{0} {
+        ASSERT(this->options.max_fan_in >= 2, "Fan-in must be at least 2");
+    }
+
+    void Run(Input &input, Output &output) {
+        std::vector<RunFile> runs;
+        std::vector<Entry> chunk;
+        while (ReadChunk(input, chunk)) {
+            SortChunk(chunk);
+            if (runs.empty() && !input) {
+                // everything fit in memory
+                Emit(chunk, output);
+                return;
+            }
+            runs.push_back(NewRun());
+            Output run{runs.back().Path()};
+            Emit(chunk, run, true);
+            run.Close();
+        }
+
+        while (runs.size() > options.max_fan_in) {
+            std::vector<RunFile> merged;
+            for (size_t begin = 0; begin < runs.size(); begin += options.max_fan_in) {
+                const auto end = std::min(runs.size(), begin + options.max_fan_in);
+                merged.push_back(NewRun());
+                Output run{merged.back().Path()};
+                Merge(runs.begin() + begin, runs.begin() + end, run, true);
+                run.Close();
+            }
+            runs.swap(merged);
+        }
+        Merge(runs.begin(), runs.end(), output, false);
+    }
+
+    /**
+     * number of runs spilled so far, including intermediate merge passes
+     */
+    size_t NumRuns() const { return num_runs; }
+
+private:
+    /**
+     * Temporary file owned by this object and removed with it
+     */
+    class RunFile {
+    public:
+        /**
+         * Create a new empty file in dir, failing rather than reusing an existing one
+         * throws exception if it cannot be created
+         */
+        explicit RunFile(const std::string &dir) : path{dir + "/hara_sort_XXXXXX"} {
+            const auto fd = mkstemp(&path[0]);
+            if (fd < 0) throw std::runtime_error("Cannot create a temporary file in " + dir);
+            close(fd);
+        }
+
+        RunFile(RunFile &&that) noexcept: path{std::move(that.path)} { that.path.clear(); }
+
+        RunFile &operator=(RunFile &&that) noexcept {
+            if (this != &that) {
+                Remove();
+                path = std::move(that.path);
+                that.path.clear();
+            }
+            return *this;
+        }
+
+        RunFile(const RunFile &) = delete;
+
+        RunFile &operator=(const RunFile &) = delete;
+
+        ~RunFile() { Remove(); }
+
+        const std::string &Path() const { return path; }
+
+        void Remove() {
+            if (path.empty()) return;
+            std::remove(path.c_str());
+            path.clear();
+        }
+
+    private:
+        std::string path;
+    };
+
+    struct Entry {
+        std::string line;
+        size_t count;
+
+        bool operator<(const Entry &that) const { return line < that.line; }
+    };
+
+    bool Aggregate() const { return options.unique || options.count; }
+
+    /**
+     * Fill chunk with lines up to the memory limit, but at least one
+     * @return false if there was nothing left to read
+     */
+    bool ReadChunk(Input &input, std::vector<Entry> &chunk) const {
+        chunk.clear();
+        size_t bytes = 0;
+        std::string line;
+        while ((chunk.empty() || bytes < options.memory_limit) && input.GetLine(line)) {
+            bytes += line.size() + sizeof(Entry);
+            chunk.push_back(Entry{std::move(line), 1});
+            line = std::string{};
+        }
+        return !chunk.empty();
+    }
+
+    /**
+     * Sort num_threads slices in parallel, then merge them pairwise in place
+     */
+    void SortChunk(std::vector<Entry> &chunk) const {
+        const auto num_slices = std::max<size_t>(1, std::min(options.num_threads, chunk.size()));
+        std::vector<size_t> bounds;
+        for (size_t idx = 0; idx <= num_slices; ++idx) bounds.push_back(chunk.size() * idx / num_slices);
+
+        std::vector<std::thread> threads;
+        for (size_t idx = 1; idx < num_slices; ++idx)
+            threads.emplace_back([&chunk, &bounds, idx]() {
+                std::sort(chunk.begin() + bounds[idx], chunk.begin() + bounds[idx + 1]);
+            });
+        std::sort(chunk.begin(), chunk.begin() + bounds[1]);
+        for (auto &thread : threads) thread.join();
+
+        for (size_t width = 1; width < num_slices; width *= 2) {
+            for (size_t idx = 0; idx + width < num_slices; idx += 2 * width) {
+                const auto end = std::min(num_slices, idx + 2 * width);
+                std::inplace_merge(chunk.begin() + bounds[idx], chunk.begin() + bounds[idx + width],
+                                   chunk.begin() + bounds[end]);
+            }
+        }
+    }
+
+    /**
+     * Write a sorted chunk, aggregating adjacent duplicates if asked
+     * Runs keep counts in front of every line so later merges can add them up
+     */
+    void Emit(const std::vector<Entry> &chunk, Output &output, bool is_run = false) const {
+        std::string pending;
+        size_t count = 0;
+        for (const auto &entry : chunk) {
+            if (Aggregate() && count > 0 && entry.line == pending) {
+                count += entry.count;
+                continue;
+            }
+            if (count > 0) Write(output, pending, count, is_run);
+            pending = entry.line;
+            count = entry.count;
+        }
+        if (count > 0) Write(output, pending, count, is_run);
+    }
+
+    void Write(Output &output, const std::string &line, size_t count, bool is_run) const {
+        if (is_run ? Aggregate() : options.count) output << std::to_string(count) << '\t';
+        output << line << '\n';
+    }
+
+    /**
+     * Read the next entry of a run written by Write
+     */
+    bool ReadRun(Input &run, Entry &entry) const {
+        if (!run.GetLine(entry.line)) return false;
+        entry.count = 1;
+        if (Aggregate()) {
+            const auto tab = entry.line.find('\t');
+            ASSERT(tab != std::string::npos, "Corrupted run");
+            entry.count = std::stoul(entry.line.substr(0, tab));
+            entry.line.erase(0, tab + 1);
+        }
+        return true;
+    }
+
+    /**
+     * k-way merge of [begin, end); the run with the smallest current line sits on top of the queue
+     * Every run file is removed once merged
+     */
+    void Merge(std::vector<RunFile>::iterator begin, std::vector<RunFile>::iterator end, Output &output,
+               bool is_run) const {
+        const auto size = static_cast<size_t>(end - begin);
+        std::vector<std::unique_ptr<Input>> inputs;
+        PriorityQueue1<size_t, std::string, std::greater<std::string>> queue;
+        Entry entry;
+        std::vector<size_t> counts(size, 0);
+        for (size_t idx = 0; idx < size; ++idx) {
+            inputs.emplace_back(new Input{begin[idx].Path()});
+            if (ReadRun(*inputs[idx], entry)) {
+                counts[idx] = entry.count;
+                queue.InsertOrUpdate({idx, std::move(entry.line)});
+            }
+        }
+
+        std::string pending;
+        size_t count = 0;
+        while (!queue.Empty()) {
+            const auto idx = queue.Top().first;
+            if (Aggregate() && count > 0 && queue.Top().second == pending) {
+                count += counts[idx];
+            } else {
+                if (count > 0) Write(output, pending, count, is_run);
+                pending = queue.Top().second;
+                count = counts[idx];
+            }
+            if (ReadRun(*inputs[idx], entry)) {
+                counts[idx] = entry.count;
+                queue.InsertOrUpdate({idx, std::move(entry.line)});
+            } else {
+                queue.Pop();
+            }
+        }
+        if (count > 0) Write(output, pending, count, is_run);
+
+        inputs.clear();
+        for (auto it = begin; it != end; ++it) it->Remove();
+    }
+
+    RunFile NewRun() {
+        RunFile run{options.tmpdir};
+        ++num_runs;
+        return run;
+    }
+
+    const Options options;
+    size_t num_runs;
+};
+
+}
+
+#endif //HARA_EXTERNAL_SORT_H
@@ -0,0 +1,112 @@
+#ifndef HARA_FINGERPRINT_H
+#define HARA_FINGERPRINT_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "StringView.h"
+
+namespace hara {
+
+/**
+ * 64-bit hash of a string, 8 bytes at a time, with a full avalanche at the end (MurmurHash3 finalizer)
+ * For set membership within one process only: the value depends on the byte order of the machine
+ */
+inline uint64_t Fingerprint(StringView s, uint64_t seed = 0) {
+    const uint64_t c1 = 0x87c37b91114253d5ull, c2 = 0x4cf5ad432745937full;
+    auto rotl = [](uint64_t x, unsigned r) { return (x << r) | (x >> (64u - r)); };
+    auto mix = [&](uint64_t k) { return rotl(k * c1, 31) * c2; };
+
+    uint64_t h = seed ^ (s.size() * c2);
+    auto p = s.data();
+    auto n = s.size();
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t k;
+        std::memcpy(&k, p, 8);
+        h = rotl(h ^ mix(k), 27) * 5 + 0x52dce729;
+    }
+    if (n > 0) {
+        uint64_t k = 0;
+        std::memcpy(&k, p, n);
+        h ^= mix(k);
+    }
+
+    h ^= h >> 33u;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33u;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33u;
+    return h;
+}
+
+/**
+ * Set of 64-bit fingerprints with open addressing (linear probing), 8 bytes per slot
+ * Fingerprints are expected to be uniformly distributed; 0 and 1 are treated as the same value
+ */
+class FingerprintSet {
+public:
+    explicit FingerprintSet(size_t capacity = 1024) : size{0} {
+        size_t n = 16;
+        while (n < capacity) n <<= 1u;
+        slots.resize(n);
+    }
+
+    /**
+     * @return false if already present
+     * Complexity: amortized O(1)
+     */
+    bool Insert(uint64_t fingerprint) {
+        if ((size + 1) * 10 > slots.size() * 7) Grow();
+        auto &slot = Probe(slots, fingerprint);
+        if (slot) return false;
+        slot = Key(fingerprint);
+        ++size;
+        return true;
+    }
+
+    bool Contain(uint64_t fingerprint) const {
+        const auto mask = slots.size() - 1;
+        const auto key = Key(fingerprint);
+        for (auto idx = key & mask;; idx = (idx + 1) & mask) {
+            if (slots[idx] == key) return true;
+            if (slots[idx] == 0) return false;
+        }
+    }
+
+    size_t Size() const { return size; }
+
+    /**
+     * bytes held by the slots
+     */
+    size_t MemoryUsage() const { return slots.size() * sizeof(uint64_t); }
+
+private:
+    // 0 marks an empty slot
+    static uint64_t Key(uint64_t fingerprint) { return fingerprint ? fingerprint : 1; }
+
+    /**
+     * The slot holding fingerprint, or the empty one where it belongs
+     */
+    static uint64_t &Probe(std::vector<uint64_t> &slots, uint64_t fingerprint) {
+        const auto mask = slots.size() - 1;
+        const auto key = Key(fingerprint);
+        for (auto idx = key & mask;; idx = (idx + 1) & mask) {
+            auto &slot = slots[idx];
+            if (slot == 0 || slot == key) return slot;
+        }
+    }
+
+    void Grow() {
+        std::vector<uint64_t> grown(slots.size() * 2, 0);
+        for (auto key : slots)
+            if (key) Probe(grown, key) = key;
+        slots.swap(grown);
+    }
+
+    std::vector<uint64_t> slots;
+    size_t size;
+};
+
+}
+
+#endif //HARA_FINGERPRINT_H
@@ -0,0 +1,127 @@
+#ifndef HARA_FREQUENCY_TABLE_H
+#define HARA_FREQUENCY_TABLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "Arena.h"
+#include "StringView.h"
+
+namespace hara {
+
+/**
+ * String -> count hash table with open addressing (linear probing)
+ *
+ * Keys are looked up as views and copied into an arena only on first insertion,
+ * so counting a token that is already present does not allocate
+ * Not thread-safe; give every thread its own table and Merge them
+ */
+class FrequencyTable {
+public:
+    explicit FrequencyTable(size_t capacity = 1024) : size{0} {
+        size_t n = 16;
+        while (n < capacity) n <<= 1u;
+        slots.resize(n);
+    }
+
+    FrequencyTable(FrequencyTable &&) = default;
+
+    FrequencyTable &operator=(FrequencyTable &&) = default;
+
+    /**
+     * Complexity: amortized O(1)
+     */
+    void Add(StringView key, uint64_t count = 1) {
+        if ((size + 1) * 10 > slots.size() * 7) Grow();
+        const auto hash = Hash(key);
+        auto &slot = Probe(slots, key, hash);
+        if (slot.count == 0) {
+            slot.key = arena.Store(key);
+            slot.hash = hash;
+            ++size;
+        }
+        slot.count += count;
+    }
+
+    /**
+     * @return 0 if absent
+     */
+    uint64_t Count(StringView key) const {
+        const auto mask = slots.size() - 1;
+        const auto hash = Hash(key);
+        for (auto idx = hash & mask;; idx = (idx + 1) & mask) {
+            const auto &slot = slots[idx];
+            if (slot.count == 0) return 0;
+            if (slot.hash == hash && slot.key == key) return slot.count;
+        }
+    }
+
+    /**
+     * Add every count of that into this
+     */
+    void Merge(const FrequencyTable &that) {
+        for (const auto &slot : that.slots)
+            if (slot.count) Add(slot.key, slot.count);
+    }
+
+    /**
+     * Entries by decreasing count, ties by key; at most n of them
+     * Views point into this table
+     * Complexity: O(N lg(n))
+     */
+    std::vector<std::pair<StringView, uint64_t>> Sorted(size_t n = SIZE_MAX) const {
+        std::vector<std::pair<StringView, uint64_t>> entries;
+        entries.reserve(size);
+        for (const auto &slot : slots)
+            if (slot.count) entries.emplace_back(slot.key, slot.count);
+        auto by_count = [](const std::pair<StringView, uint64_t> &a, const std::pair<StringView, uint64_t> &b) {
+            return a.second > b.second || (a.second == b.second && a.first < b.first);
+        };
+        n = std::min(n, entries.size());
+        std::partial_sort(entries.begin(), entries.begin() + n, entries.end(), by_count);
+        entries.resize(n);
+        return entries;
+    }
+
+    size_t Size() const { return size; }
+
+    bool Empty() const { return size == 0; }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        StringView key;
+        // 0 marks an empty slot
+        uint64_t count = 0;
+    };
+
+    static uint64_t Hash(StringView key) { return std::hash<StringView>()(key); }
+
+    static Slot &Probe(std::vector<Slot> &slots, StringView key, uint64_t hash) {
+        const auto mask = slots.size() - 1;
+        for (auto idx = hash & mask;; idx = (idx + 1) & mask) {
+            auto &slot = slots[idx];
+            if (slot.count == 0 || (slot.hash == hash && slot.key == key)) return slot;
+        }
+    }
+
+    /**
+     * Double the slots; keys stay where they are in the arena
+     */
+    void Grow() {
+        std::vector<Slot> grown(slots.size() * 2);
+        for (const auto &slot : slots)
+            if (slot.count) Probe(grown, slot.key, slot.hash) = slot;
+        slots.swap(grown);
+    }
+
+    std::vector<Slot> slots;
+    size_t size;
+    Arena arena;
+};
+
+}
+
+#endif //HARA_FREQUENCY_TABLE_H
@@ -1,32 +1,43 @@
 #ifndef IO_INPUT_H
 #define IO_INPUT_H
 
+#include <cstring>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <memory>
 #include <stdexcept>
+#include <type_traits>
+#include "Compression.h"
+#include "Number.h"
+#include "StringView.h"
+#include "Stats.h"
 
 namespace hara {
 
 /** Minimalistic input-handling class
  * that could be from a file or piped stdin
  *
+ * gzip and zstd streams are detected by their magic bytes on the first read,
+ * so constructing an Input on stdin does not block, and decompressed on a helper thread
+ *
  * Only support forward reading methods
  *
  */
 class Input {
 public:
-    explicit Input(const std::string &path) {
+    explicit Input(const std::string &path) : num_lines{0} {
         std::ios::sync_with_stdio(false);
         if (path == "-") {
 #ifdef HARA_VERBOSE
-            std::cerr << "Reading form stdin" << std::endl;
+            std::cerr << "Reading form stdin" << '\n';
 #endif
             buf = std::cin.rdbuf();
         } else {
 #ifdef HARA_VERBOSE
-            std::cerr << "Reading from " << path << std::endl;
+            std::cerr << "Reading from " << path << '\n';
 #endif
             ifs = std::unique_ptr<std::ifstream>{new std::ifstream{path}};
             if (!ifs->is_open())
@@ -42,12 +53,49 @@ public:
      * Get current line; does not return endl char
      */
     Input &GetLine(std::string &line) {
-        static const size_t LOG_NUM_LINES = 1000000;
-        static size_t n = 0;
+        if (!detected) Detect();
         std::getline(*in, line);
+        if (!in->fail()) {
+            // plus the endl char unless the last line lacks one
+            stats.bytes_read.Add(line.size() + !in->eof());
+            stats.lines.Add();
+        }
+#ifdef HARA_VERBOSE
+        if (++num_lines % LOG_NUM_LINES == 0) {
+            std::cerr << "Reading line #" << num_lines << '\n';
+        }
+#endif
+        return *this;
+    }
+
+    /**
+     * Get current line as a view into an internal block buffer, without copying it out;
+     * does not return endl char
+     * The view is valid until the next read. Reads by view must not be mixed
+     * with other reads on the same instance, since they buffer ahead on their own
+     */
+    Input &GetLine(StringView &line) {
+        if (!detected) Detect();
+        while (true) {
+            const auto begin = block.data() + block_begin, end = block.data() + block_end;
+            auto endl = begin == end ? nullptr : static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+            if (endl || (block_eof && begin != end)) {
+                line = {begin, static_cast<size_t>((endl ? endl : end) - begin)};
+                block_begin += line.size() + (endl ? 1 : 0);
+                stats.bytes_read.Add(line.size() + (endl ? 1 : 0));
+                stats.lines.Add();
+                break;
+            }
+            if (block_eof) {
+                line = {};
+                in->setstate(std::ios_base::eofbit | std::ios_base::failbit);
+                return *this;
+            }
+            FillBlock();
+        }
 #ifdef HARA_VERBOSE
-        if (++n % LOG_NUM_LINES == 0) {
-            std::cerr << "Reading line #" << n << std::endl;
+        if (++num_lines % LOG_NUM_LINES == 0) {
+            std::cerr << "Reading line #" << num_lines << '\n';
         }
 #endif
         return *this;
@@ -67,16 +115,137 @@ public:
         return content;
     }
 
+    /**
+     * Integers and floats skip iostream's locale machinery unless the stream flags were changed:
+     * the longest prefix that may still form a number is consumed and parsed by Number::Parse
+     * As with iostream, malformed input sets failbit and data to 0, and a number out of range
+     * sets failbit and data to the closest representable value
+     */
     template<typename T>
     Input &operator>>(T &data) {
-        *in >> data;
+        if (!detected) Detect();
+        Read(data, std::integral_constant<bool, Number::IsFast<T>::value>{});
         return *this;
     }
 
+    /**
+     * Counters of this instance; all zero unless built with HARA_STATS
+     * GetLine is the only method accounted for
+     */
+    const InputStats &Stats() const { return stats; }
+
 private:
+    static const size_t LOG_NUM_LINES = 1000000;
+
+    template<typename T>
+    void Read(T &data, std::false_type) { *in >> data; }
+
+    template<typename T>
+    void Read(T &data, std::true_type) {
+        if (in->flags() != (std::ios_base::skipws | std::ios_base::dec)) {
+            *in >> data;
+            return;
+        }
+        if (!*in) return;
+
+        typedef std::char_traits<char> traits;
+        const bool floating = std::is_floating_point<T>::value;
+        auto c = buf->sgetc();
+        while (c == ' ' || (c >= '\t' && c <= '\r')) c = buf->snextc();
+
+        number.clear();
+        bool digit = false, dot = false, exponent = false, letters = false;
+        for (; c != traits::eof(); c = buf->snextc()) {
+            const auto ch = traits::to_char_type(c);
+            if (ch == '-' || ch == '+') {
+                if (!number.empty() && !(exponent && (number.back() | 0x20) == 'e')) break;
+            } else if (ch >= '0' && ch <= '9') {
+                if (letters) break;
+                digit = true;
+            } else if (!floating) {
+                break;
+            } else if (ch == '.') {
+                if (dot || exponent || letters) break;
+                dot = true;
+            } else if ((ch | 0x20) == 'e' && !letters) {
+                if (!digit || exponent) break;
+                exponent = true;
+            } else if ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z') {
+                // inf, infinity or nan
+                if (digit || dot || number.size() > 8) break;
+                letters = true;
+            } else {
+                break;
+            }
+            number.push_back(ch);
+        }
+        if (c == traits::eof()) in->setstate(std::ios_base::eofbit);
+
+        T value{};
+        const auto end = number.data() + number.size();
+        const auto result = Number::Parse(number.data(), end, value);
+        if (result.error == Number::Error::None && result.ptr == end) {
+            data = value;
+            return;
+        }
+        if (result.error == Number::Error::OutOfRange && result.ptr == end) {
+            data = number[0] == '-' ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+        } else {
+            data = T{};
+        }
+        in->setstate(std::ios_base::failbit);
+    }
+
+    /**
+     * Put a decoding buffer between the stream and the source if it is compressed
+     */
+    void Detect() {
+        detected = true;
+        try {
+            decoding = OpenDecoding(buf);
+        } catch (...) {
+            in->setstate(std::ios_base::badbit);
+            throw;
+        }
+        if (!decoding) return;
+        buf = decoding.get();
+        in->rdbuf(buf);
+        // let decoding errors through instead of a silent end of input
+        in->exceptions(std::ios_base::badbit);
+    }
+
+    /**
+     * Move the partial line in front of the block and read after it, growing the block for long lines
+     */
+    void FillBlock() {
+        const auto pending = block_end - block_begin;
+        if (block.empty()) block.resize(size_t{1} << 18u);
+        else if (pending == block.size()) block.resize(block.size() * 2);
+        std::memmove(block.data(), block.data() + block_begin, pending);
+        block_begin = 0;
+        block_end = pending;
+        const auto n = buf->sgetn(block.data() + block_end, static_cast<std::streamsize>(block.size() - block_end));
+        block_end += static_cast<size_t>(n);
+        block_eof = n == 0;
+    }
+
     std::streambuf *buf;
     std::unique_ptr<std::ifstream> ifs;
+    // reads from ifs or stdin, so declared after ifs
+    std::unique_ptr<std::streambuf> decoding;
     std::unique_ptr<std::istream> in;
+    // codec detection deferred to the first read
+    bool detected = false;
+    // lines read by this instance, for progress logging
+    size_t num_lines;
+    // token being parsed by operator>>
+    std::string number;
+    // read ahead by GetLine(StringView &)
+    std::vector<char> block;
+    size_t block_begin = 0;
+    size_t block_end = 0;
+    bool block_eof = false;
+    InputStats stats;
 };
 
 }
@@ -0,0 +1,375 @@
+#ifndef HARA_NUMBER_H
+#define HARA_NUMBER_H
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <locale.h>
+#include <memory>
+#include <type_traits>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
+namespace hara {
+
+/** Locale-independent number parsing and formatting,
+ * in the spirit of std::from_chars / std::to_chars
+ *
+ * The fast paths are hand-written; the rare fallbacks to strtod / snprintf switch the calling thread
+ * to the "C" locale (POSIX uselocale) for the call, so '.' is the decimal point whatever LC_NUMERIC says
+ *
+ * Parse never reads past end, skips no whitespace and fails in a well-defined way:
+ * on error value is left untouched and the result tells whether the text was not a number at all
+ * or a number out of the range of the type
+ */
+class Number {
+public:
+    enum class Error {
+        None, Invalid, OutOfRange
+    };
+
+    struct ParseResult {
+        // one past the last char of the number, begin if Invalid
+        const char *ptr;
+        Error error;
+    };
+
+    /**
+     * Types with a fast path in Input::operator>> and Output::operator<<
+     * Character types and bool keep their iostream meaning; long double is left to iostream
+     */
+    template<typename T>
+    struct IsFast : std::integral_constant<bool,
+            (std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value &&
+             !std::is_same<T, signed char>::value && !std::is_same<T, unsigned char>::value &&
+             !std::is_same<T, wchar_t>::value && !std::is_same<T, char16_t>::value &&
+             !std::is_same<T, char32_t>::value) ||
+            std::is_same<T, float>::value || std::is_same<T, double>::value> {
+    };
+
+    // enough for any integer and for the longest float such as -1.2345678901234567e-308
+    static constexpr size_t MAX_LENGTH = 32;
+
+    /**
+     * [+-]?[0-9]+
+     * A minus sign on an unsigned type is a format error (Invalid, ptr at begin) unless the value is 0;
+     * unlike std::stoul, "-5" never wraps around to a huge value
+     */
+    template<typename T>
+    static typename std::enable_if<std::is_integral<T>::value, ParseResult>::type
+    Parse(const char *begin, const char *end, T &value) {
+        auto it = begin;
+        const bool negative = it != end && *it == '-';
+        if (it != end && (*it == '-' || *it == '+')) ++it;
+
+        const auto digits = it;
+        while (it != end && IsDigit(*it)) ++it;
+        if (it == digits) return {begin, Error::Invalid};
+
+        // 19 digits always fit in 64 bits; only longer runs need overflow checks
+        uint64_t magnitude = 0;
+        bool overflow = false;
+        for (auto p = digits; p != it; ++p) {
+            const auto digit = static_cast<unsigned>(*p - '0');
+            if (p - digits >= 19 && magnitude > (UINT64_MAX - digit) / 10) overflow = true;
+            magnitude = magnitude * 10 + digit;
+        }
+
+        if (negative && !std::is_signed<T>::value && (overflow || magnitude != 0)) return {begin, Error::Invalid};
+        const auto max = static_cast<uint64_t>(std::numeric_limits<T>::max());
+        const uint64_t limit = negative ? (std::is_signed<T>::value ? max + 1 : 0) : max;
+        if (overflow || magnitude > limit) return {it, Error::OutOfRange};
+        if (!negative || magnitude == 0) value = static_cast<T>(magnitude);
+        else value = static_cast<T>(-static_cast<T>(magnitude - 1) - 1);
+        return {it, Error::None};
+    }
+
+    /**
+     * [+-]?(digits[.digits?]|.digits)([eE][+-]?digits)? or inf, infinity, nan in any case
+     * An exponent without digits is not part of the number, as with std::from_chars
+     *
+     * Up to 19 significant digits whose value and power of ten are exact in T are converted
+     * with one correctly rounded multiplication or division (Clinger's fast path);
+     * anything else goes through strtod
+     * Out of range: beyond the largest finite value; underflow rounds to 0 or a subnormal
+     */
+    template<typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, ParseResult>::type
+    Parse(const char *begin, const char *end, T &value) {
+        auto it = begin;
+        const bool negative = it != end && *it == '-';
+        if (it != end && (*it == '-' || *it == '+')) ++it;
+
+        if (it != end && ((*it | 0x20) == 'i' || (*it | 0x20) == 'n')) {
+            if (MatchWord(it, end, "inf")) {
+                MatchWord(it, end, "inity");
+                value = negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+            } else if (MatchWord(it, end, "nan")) {
+                value = std::numeric_limits<T>::quiet_NaN();
+            } else {
+                return {begin, Error::Invalid};
+            }
+            return {it, Error::None};
+        }
+
+        uint64_t mantissa = 0;
+        int significant = 0, exponent = 0;
+        bool any_digit = false, truncated = false;
+        auto digit = [&](char c, bool fraction) {
+            any_digit = true;
+            if (significant == 0 && c == '0') {
+                exponent -= fraction;
+            } else if (significant < 19) {
+                mantissa = mantissa * 10 + static_cast<unsigned>(c - '0');
+                ++significant;
+                exponent -= fraction;
+            } else {
+                exponent += !fraction;
+                truncated |= c != '0';
+            }
+        };
+        for (; it != end && IsDigit(*it); ++it) digit(*it, false);
+        if (it != end && *it == '.') {
+            auto p = it + 1;
+            for (; p != end && IsDigit(*p); ++p) digit(*p, true);
+            if (any_digit) it = p;
+        }
+        if (!any_digit) return {begin, Error::Invalid};
+
+        if (it != end && (*it | 0x20) == 'e') {
+            auto p = it + 1;
+            const bool negative_exponent = p != end && *p == '-';
+            if (p != end && (*p == '-' || *p == '+')) ++p;
+            if (p != end && IsDigit(*p)) {
+                int e = 0;
+                for (; p != end && IsDigit(*p); ++p)
+                    if (e < 100000) e = e * 10 + (*p - '0');
+                exponent += negative_exponent ? -e : e;
+                it = p;
+            }
+        }
+
+        const auto max_pow10 = MaxExactPow10<T>();
+        if (!truncated && mantissa <= uint64_t{1} << std::numeric_limits<T>::digits &&
+            exponent >= -max_pow10 && exponent <= max_pow10) {
+            auto result = static_cast<T>(mantissa);
+            const auto scale = static_cast<T>(Pow10(exponent < 0 ? -exponent : exponent));
+            result = exponent < 0 ? result / scale : result * scale;
+            value = negative ? -result : result;
+            return {it, Error::None};
+        }
+
+        // strtod needs a terminated string; the number itself is short unless it has absurdly many digits
+        char buffer[128];
+        std::unique_ptr<char[]> heap;
+        const auto length = static_cast<size_t>(it - begin);
+        char *text = buffer;
+        if (length >= sizeof(buffer)) {
+            heap.reset(new char[length + 1]);
+            text = heap.get();
+        }
+        std::memcpy(text, begin, length);
+        text[length] = '\0';
+        CLocale c_locale;
+        errno = 0;
+        const auto converted = StrToD(text, T{});
+        if (errno == ERANGE && std::isinf(converted)) return {it, Error::OutOfRange};
+        value = converted;
+        return {it, Error::None};
+    }
+
+    /**
+     * Decimal digits of value, two at a time
+     * @param out room for MAX_LENGTH chars
+     * @return one past the last char written; nothing is terminated
+     */
+    template<typename T>
+    static typename std::enable_if<std::is_integral<T>::value, char *>::type
+    Format(char *out, T value) {
+        static const char DIGITS[] =
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+        auto magnitude = static_cast<uint64_t>(value);
+        if (IsNegative(value)) {
+            *out++ = '-';
+            magnitude = 0 - magnitude;
+        }
+
+        size_t length = 1;
+        for (auto m = magnitude; m >= 10; m /= 10) ++length;
+        auto p = out + length;
+        while (magnitude >= 100) {
+            const auto idx = (magnitude % 100) * 2;
+            magnitude /= 100;
+            *--p = DIGITS[idx + 1];
+            *--p = DIGITS[idx];
+        }
+        if (magnitude >= 10) {
+            *--p = DIGITS[magnitude * 2 + 1];
+            *--p = DIGITS[magnitude * 2];
+        } else {
+            *--p = static_cast<char>('0' + magnitude);
+        }
+        return out + length;
+    }
+
+    /**
+     * Shortest text that parses back to exactly value; positional where %g would be
+     * (1e-4 <= |value| < 10^digits10), otherwise %g's exponent notation; inf, -inf, nan
+     *
+     * Positional values take the fewest fraction digits k for which round(|value| * 10^k) / 10^k,
+     * computed exactly and correctly rounded in T, is value again;
+     * other values take the smallest snprintf precision whose text round-trips
+     * @param out room for MAX_LENGTH chars
+     * @return one past the last char written; nothing is terminated
+     */
+    template<typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, char *>::type
+    Format(char *out, T value) {
+        if (std::isnan(value)) {
+            std::memcpy(out, "nan", 3);
+            return out + 3;
+        }
+        if (std::signbit(value)) *out++ = '-';
+        const T magnitude = std::fabs(value);
+        if (std::isinf(magnitude)) {
+            std::memcpy(out, "inf", 3);
+            return out + 3;
+        }
+        if (magnitude == 0) {
+            *out++ = '0';
+            return out;
+        }
+
+        const int digits10 = std::numeric_limits<T>::digits10;
+        if (magnitude >= T(1e-4) && magnitude < Pow10(digits10)) {
+            const double exact_limit = static_cast<double>(uint64_t{1} << std::numeric_limits<T>::digits);
+            for (int k = 0; k <= MaxExactPow10<T>(); ++k) {
+                const double scaled = static_cast<double>(magnitude) * Pow10(k);
+                if (scaled >= exact_limit) break;
+                const auto m = static_cast<uint64_t>(scaled + 0.5);
+                if (static_cast<T>(m) / static_cast<T>(Pow10(k)) == magnitude) return Positional(out, m, k);
+            }
+        }
+
+        // round-tripping is monotonic in the precision; values that get here mostly need all of
+        // max_digits10 or close to it, so try the top precisions first and only search below digits10
+        CLocale c_locale;
+        char text[MAX_LENGTH];
+        int length = 0;
+        auto round_trips = [&](int precision) {
+            const auto n = std::snprintf(text, MAX_LENGTH, "%.*g", precision, static_cast<double>(magnitude));
+            if (StrToD(text, T{}) != magnitude) return false;
+            std::memcpy(out, text, n);
+            length = n;
+            return true;
+        };
+        if (!round_trips(digits10)) {
+            for (int precision = digits10 + 1; !round_trips(precision); ++precision) {}
+            return out + length;
+        }
+        int lo = 1, hi = digits10;
+        while (lo < hi) {
+            const auto precision = (lo + hi) / 2;
+            if (round_trips(precision)) hi = precision;
+            else lo = precision + 1;
+        }
+        // out holds the text of the last precision that round-tripped, which is hi
+        return out + length;
+    }
+
+private:
+    /**
+     * The calling thread uses the "C" locale while this is alive
+     */
+    class CLocale {
+    public:
+        CLocale() : previous{uselocale(Get())} {}
+
+        ~CLocale() { uselocale(previous); }
+
+        CLocale(const CLocale &) = delete;
+
+        CLocale &operator=(const CLocale &) = delete;
+
+    private:
+        static locale_t Get() {
+            // never freed; if it cannot be created, uselocale(0) leaves the locale as it is
+            static const locale_t c = newlocale(LC_ALL_MASK, "C", locale_t{});
+            return c;
+        }
+
+        const locale_t previous;
+    };
+
+    static bool IsDigit(char c) { return static_cast<unsigned>(c - '0') <= 9; }
+
+    template<typename T>
+    static bool IsNegative(T value) { return std::is_signed<T>::value && value < T{}; }
+
+    /**
+     * Exact powers of ten as doubles, up to 1e22
+     */
+    static double Pow10(int k) {
+        static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        return POW10[k];
+    }
+
+    /**
+     * Largest k for which 10^k is exact in T
+     */
+    template<typename T>
+    static int MaxExactPow10() {
+        if (std::numeric_limits<T>::digits <= 24) return 10;
+        return 22;
+    }
+
+    static double StrToD(const char *s, double) { return std::strtod(s, nullptr); }
+
+    static float StrToD(const char *s, float) { return std::strtof(s, nullptr); }
+
+    /**
+     * Case-insensitive match of a lowercase word, advancing it past the match
+     */
+    static bool MatchWord(const char *&it, const char *end, const char *word) {
+        auto p = it;
+        for (; *word; ++word, ++p)
+            if (p == end || (*p | 0x20) != *word) return false;
+        it = p;
+        return true;
+    }
+
+    /**
+     * m / 10^k in positional notation
+     */
+    static char *Positional(char *out, uint64_t m, int k) {
+        char digits[MAX_LENGTH];
+        const auto length = static_cast<int>(Format(digits, m) - digits);
+        if (length <= k) {
+            *out++ = '0';
+            *out++ = '.';
+            for (int i = length; i < k; ++i) *out++ = '0';
+            std::memcpy(out, digits, length);
+            return out + length;
+        }
+        std::memcpy(out, digits, length - k);
+        out += length - k;
+        if (k > 0) {
+            *out++ = '.';
+            std::memcpy(out, digits + length - k, k);
+            out += k;
+        }
+        return out;
+    }
+};
+
+}
+
+#endif //HARA_NUMBER_H
@@ -1,37 +1,48 @@
 #ifndef IO_OUTPUT_H
 #define IO_OUTPUT_H
 
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <memory>
 #include <stdexcept>
+#include <type_traits>
+#include "Compression.h"
+#include "Number.h"
+#include "StringView.h"
+#include "Stats.h"
 
 namespace hara {
 
 /** Minimalistic output-handling class
  * that could be to a file or to stdout
  *
+ * Paths ending in .gz or .zst are compressed accordingly;
+ * the stream is complete once closed, explicitly or on destruction
+ *
  * Only support forward writing methods
  *
  */
 class Output {
 public:
-    explicit Output(const std::string &path, std::ios_base::openmode mode = std::ios_base::out) {
+    explicit Output(const std::string &path, std::ios_base::openmode mode = std::ios_base::out) : path{path} {
         std::ios::sync_with_stdio(false);
         if (path == "-") {
 #ifdef HARA_VERBOSE
-            std::cerr << "Writing to stdout" << std::endl;
+            std::cerr << "Writing to stdout" << '\n';
 #endif
             buf = std::cout.rdbuf();
         } else {
 #ifdef HARA_VERBOSE
-            std::cerr << "Writing to " << path << std::endl;
+            std::cerr << "Writing to " << path << '\n';
 #endif
             ofs = std::unique_ptr<std::ofstream>{new std::ofstream{path, mode}};
             if (!ofs->is_open())
                 throw std::runtime_error("Cannot write to " + path);
             buf = ofs->rdbuf();
+            encoding = OpenEncoding(buf, CodecFromPath(path));
+            if (encoding) buf = encoding.get();
         }
         out = std::unique_ptr<std::ostream>{new std::ostream{buf}};
     }
@@ -45,27 +56,111 @@ public:
      */
     void WriteLine(const std::string &line) {
         *out << line << std::endl;
+        stats.bytes_written.Add(line.size() + 1);
+        stats.lines.Add();
+        stats.flushes.Add();
     }
 
     void Write(const std::string &content) {
         *out << content;
+        stats.bytes_written.Add(content.size());
     }
 
+    /**
+     * Integers and floats are formatted by Number::Format straight into the stream buffer
+     * unless the stream flags, width or precision were changed; floats are then written
+     * as the shortest text that reads back to the same value, instead of with 6 digits
+     * Only strings, string views, chars and such numbers are accounted for in bytes_written
+     */
     template<typename T>
     Output &operator<<(const T &data) {
-        *out << data;
+        Put(data, std::integral_constant<bool, Number::IsFast<T>::value>{});
         return *this;
     }
 
     Output &operator<<(std::ostream &(*manip)(std::ostream &)) {
         *out << manip;
+        if (manip == static_cast<std::ostream &(*)(std::ostream &)>(std::endl)) {
+            stats.bytes_written.Add();
+            stats.lines.Add();
+            stats.flushes.Add();
+        } else if (manip == static_cast<std::ostream &(*)(std::ostream &)>(std::flush)) {
+            stats.flushes.Add();
+        }
         return *this;
     }
 
+    /**
+     * false once a write failed or the output was closed
+     */
+    explicit operator bool() const { return out->operator bool(); }
+
+    /**
+     * Flush everything, write the trailer of a compressed stream and close the file
+     * Errors such as a full disk are only reported from here, not on destruction
+     * Nothing can be written afterwards
+     */
+    void Close() {
+        if (closed) return;
+        closed = true;
+        out->flush();
+        const bool flushed = !out->bad();
+        out->setstate(std::ios_base::badbit);
+        if (encoding) encoding->Close();
+        if (ofs) ofs->close();
+        if (!flushed || (ofs && ofs->fail())) throw std::runtime_error("Cannot write to " + path);
+    }
+
+    /**
+     * Counters of this instance; all zero unless built with HARA_STATS
+     */
+    const OutputStats &Stats() const { return stats; }
+
 private:
+    template<typename T>
+    void Put(const T &data, std::false_type) {
+        *out << data;
+        stats.bytes_written.Add(NumBytes(data));
+    }
+
+    template<typename T>
+    void Put(T data, std::true_type) {
+        if (out->flags() != (std::ios_base::skipws | std::ios_base::dec) || out->width() != 0 ||
+            out->precision() != 6) {
+            *out << data;
+            return;
+        }
+        // what the ostream sentry would do: nothing is written once the stream failed or was closed
+        if (!*out) {
+            out->setstate(std::ios_base::failbit);
+            return;
+        }
+        char text[Number::MAX_LENGTH];
+        const auto size = Number::Format(text, data) - text;
+        const auto written = buf->sputn(text, size);
+        if (written != size) out->setstate(std::ios_base::badbit);
+        stats.bytes_written.Add(static_cast<uint64_t>(std::max<std::streamsize>(0, written)));
+    }
+
+    template<typename T>
+    static uint64_t NumBytes(const T &) { return 0; }
+
+    static uint64_t NumBytes(const std::string &data) { return data.size(); }
+
+    static uint64_t NumBytes(const StringView &data) { return data.size(); }
+
+    static uint64_t NumBytes(const char *data) { return std::char_traits<char>::length(data); }
+
+    static uint64_t NumBytes(char) { return 1; }
+
+    const std::string path;
     std::streambuf *buf;
     std::unique_ptr<std::ofstream> ofs;
+    // writes its trailer to ofs on destruction, so declared after ofs
+    std::unique_ptr<EncodingBuf> encoding;
     std::unique_ptr<std::ostream> out;
+    bool closed = false;
+    OutputStats stats;
 };
 
 }
@@ -0,0 +1,168 @@
+#ifndef HARA_PIPELINE_H
+#define HARA_PIPELINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+#include "Input.h"
+#include "Output.h"
+#include "StringView.h"
+
+namespace hara {
+
+/**
+ * Line-by-line transform of an Input into an Output over three stages:
+ * a reader filling batches of lines, num_threads workers transforming them,
+ * and a writer (the calling thread) restoring input order
+ *
+ * Stages are connected by bounded queues and a fixed set of batches is recycled,
+ * so memory stays bounded; a batch keeps its lines and its results back to back in two buffers,
+ * which keep their capacity across batches, so steady state does not allocate per line
+ *
+ * Scaling with the number of workers is measured by `hara_bench --filter lpm/pipeline`.
+ * Scaling to 8 cores has NOT been demonstrated: so far threads2..8 take 1.3-1.6x the time of threads1
+ * (e.g. 730-765 ms against 459 ms), and no run has yet shown a speedup over a single thread
+ */
+class Pipeline {
+public:
+    /**
+     * @param num_threads workers; with 1 or less everything runs on the calling thread
+     * @param batch_size lines handed to a worker at a time
+     */
+    explicit Pipeline(size_t num_threads, size_t batch_size = 4096)
+            : num_threads{num_threads}, batch_size{std::max<size_t>(1, batch_size)} {}
+
+    /**
+     * transform(const std::string &line, std::string &result) is called concurrently
+     * and writes the replacement for line into result; each result is written as is,
+     * so the transform appends its own endl char if it wants one
+     * An exception thrown by transform stops the pipeline and is rethrown here
+     * With more than one thread lines are read by view (GetLine(StringView &)),
+     * so the input must not be read otherwise after the call
+     */
+    template<typename Transform>
+    void Run(Input &input, Output &output, Transform transform) const {
+        if (num_threads <= 1) {
+            std::string line, result;
+            while (input.GetLine(line)) {
+                transform(line, result);
+                output << result;
+            }
+            return;
+        }
+
+        // enough batches for every worker plus one being filled and the queues in between
+        const size_t num_batches = 3 * num_threads + 2;
+        std::vector<Batch> batches(num_batches);
+        BoundedQueue<Batch *> free{num_batches}, work{num_batches}, done{num_batches};
+        for (auto &batch : batches) {
+            batch.ends.reserve(batch_size);
+            free.Push(&batch);
+        }
+
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto fail = [&]() {
+            {
+                std::lock_guard<std::mutex> lock{error_mutex};
+                if (!error) error = std::current_exception();
+            }
+            free.Close();
+            work.Close();
+            done.Close();
+        };
+
+        std::thread reader{[&]() {
+            try {
+                Batch *batch;
+                StringView line;
+                for (size_t seq = 0; free.Pop(batch); ++seq) {
+                    batch->seq = seq;
+                    batch->lines.clear();
+                    batch->ends.clear();
+                    while (batch->ends.size() < batch_size && input.GetLine(line)) {
+                        batch->lines.append(line.data(), line.size());
+                        batch->ends.push_back(batch->lines.size());
+                    }
+                    const bool last = batch->ends.size() < batch_size;
+                    if (!batch->ends.empty() && !work.Push(batch)) break;
+                    if (last) break;
+                }
+            } catch (...) {
+                fail();
+            }
+            work.Close();
+        }};
+
+        std::atomic<size_t> running{num_threads};
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            workers.emplace_back([&]() {
+                try {
+                    // transform takes strings; these keep their capacity across lines
+                    std::string line, result;
+                    Batch *batch;
+                    while (work.Pop(batch)) {
+                        batch->results.clear();
+                        size_t begin = 0;
+                        for (const auto end : batch->ends) {
+                            line.assign(batch->lines, begin, end - begin);
+                            transform(line, result);
+                            batch->results += result;
+                            begin = end;
+                        }
+                        if (!done.Push(batch)) break;
+                    }
+                } catch (...) {
+                    fail();
+                }
+                if (--running == 0) done.Close();
+            });
+        }
+
+        try {
+            // out-of-order batches wait here; bounded by num_batches
+            std::map<size_t, Batch *> pending;
+            size_t next = 0;
+            Batch *batch;
+            while (done.Pop(batch)) {
+                pending.emplace(batch->seq, batch);
+                for (auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it)) {
+                    output << it->second->results;
+                    ++next;
+                    free.Push(it->second);
+                }
+            }
+        } catch (...) {
+            fail();
+        }
+
+        reader.join();
+        for (auto &worker : workers) worker.join();
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    struct Batch {
+        size_t seq = 0;
+        // lines without their endl chars, back to back
+        std::string lines;
+        // end of every line in lines
+        std::vector<size_t> ends;
+        // results of the lines, in order
+        std::string results;
+    };
+
+    const size_t num_threads;
+    const size_t batch_size;
+};
+
+}
+
+#endif //HARA_PIPELINE_H
@@ -0,0 +1,116 @@
+#ifndef HARA_POOL_ALLOCATOR_H
+#define HARA_POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace hara {
+
+/**
+ * Recycles fixed-size blocks through per-size free lists
+ * and carves fresh blocks out of chunks,
+ * so a steady state of frees followed by allocations never reaches malloc
+ *
+ * Not thread-safe; meant to be owned by a single container
+ */
+class NodePool {
+public:
+    NodePool() = default;
+
+    NodePool(const NodePool &) = delete;
+
+    NodePool &operator=(const NodePool &) = delete;
+
+    ~NodePool() {
+        for (auto chunk : chunks) ::operator delete(chunk);
+    }
+
+    void *Allocate(size_t size) {
+        const auto slot = Slot(size);
+        if (slot >= free_lists.size()) free_lists.resize(slot + 1, nullptr);
+        auto &head = free_lists[slot];
+        if (!head) Refill(slot);
+        auto block = head;
+        head = block->next;
+        return block;
+    }
+
+    void Deallocate(void *p, size_t size) {
+        auto block = static_cast<Block *>(p);
+        auto &head = free_lists[Slot(size)];
+        block->next = head;
+        head = block;
+    }
+
+    /**
+     * number of chunks requested from the global allocator so far
+     */
+    size_t NumChunks() const { return chunks.size(); }
+
+private:
+    struct Block {
+        Block *next;
+    };
+
+    static constexpr size_t ALIGN = alignof(std::max_align_t);
+    static constexpr size_t BLOCKS_PER_CHUNK = 256;
+
+    static size_t Slot(size_t size) { return (size + ALIGN - 1) / ALIGN; }
+
+    void Refill(size_t slot) {
+        const auto block_size = slot * ALIGN;
+        auto chunk = static_cast<char *>(::operator new(block_size * BLOCKS_PER_CHUNK));
+        chunks.push_back(chunk);
+        for (auto idx = BLOCKS_PER_CHUNK; idx-- > 0;)
+            Deallocate(chunk + idx * block_size, block_size);
+    }
+
+    std::vector<Block *> free_lists;
+    std::vector<void *> chunks;
+};
+
+/**
+ * Standard allocator over a NodePool, for node-based containers
+ * Each default-constructed allocator owns a fresh pool; copies and rebinds share it
+ * Array allocations bypass the pool
+ */
+template<typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() : pool{std::make_shared<NodePool>()} {}
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U> &that) noexcept : pool{that.pool} {}
+
+    T *allocate(size_t n) {
+        if (n != 1) return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(pool->Allocate(sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) noexcept {
+        if (n != 1) ::operator delete(p);
+        else pool->Deallocate(p, sizeof(T));
+    }
+
+    const NodePool &Pool() const { return *pool; }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U> &that) const { return pool == that.pool; }
+
+    template<typename U>
+    bool operator!=(const PoolAllocator<U> &that) const { return pool != that.pool; }
+
+private:
+    std::shared_ptr<NodePool> pool;
+
+    template<typename U>
+    friend class PoolAllocator;
+};
+
+}
+
+#endif //HARA_POOL_ALLOCATOR_H
@@ -0,0 +1,101 @@
+#ifndef HARA_PREFIX_ENCODER_H
+#define HARA_PREFIX_ENCODER_H
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Vocabulary.h"
+
+namespace hara {
+
+/**
+ * Greedy longest-prefix-match encoder over a vocabulary
+ *
+ * Encode cuts each whitespace-separated token into the longest units
+ * that are a prefix of some vocabulary entry; a char that starts no such unit becomes <unk>
+ *
+ * EncodeIds cuts into the longest units that are vocabulary entries,
+ * since only those have an id; a char that starts none becomes Vocabulary::UNKNOWN
+ *
+ * The vocabulary is read-only once built, so encoding may run on several threads
+ */
+class PrefixEncoder {
+public:
+    PrefixEncoder() = default;
+
+    template<typename Container>
+    explicit PrefixEncoder(const Container &vocab) {
+        for (const auto &token : vocab) Insert(token);
+    }
+
+    uint32_t Insert(const std::string &token) { return vocabulary.Insert(token); }
+
+    /**
+     * Encode the line into encoded, reusing its capacity
+     * units are separated by a single space
+     */
+    void Encode(const std::string &line, std::string &encoded) const {
+        encoded.clear();
+        ForEachToken(line, [this, &encoded](std::string::const_iterator it, std::string::const_iterator end) {
+            while (it != end) {
+                if (!encoded.empty()) encoded.push_back(' ');
+                const auto length = vocabulary.LongestPrefix(it, end);
+                if (length == 0) {
+                    encoded.append("<unk>");
+                    ++it;
+                } else {
+                    encoded.append(it, it + length);
+                    it += length;
+                }
+            }
+        });
+    }
+
+    std::string Encode(const std::string &line) const {
+        std::string encoded;
+        Encode(line, encoded);
+        return encoded;
+    }
+
+    /**
+     * Encode the line into vocabulary ids, reusing the capacity of ids
+     */
+    void EncodeIds(const std::string &line, std::vector<uint32_t> &ids) const {
+        ids.clear();
+        ForEachToken(line, [this, &ids](std::string::const_iterator it, std::string::const_iterator end) {
+            while (it != end) {
+                uint32_t id;
+                const auto length = vocabulary.LongestMatch(it, end, id);
+                ids.push_back(id);
+                it += length ? length : 1;
+            }
+        });
+    }
+
+    const Vocabulary &GetVocabulary() const { return vocabulary; }
+
+    size_t Size() const { return vocabulary.Size() - 1; }
+
+private:
+    template<typename Function>
+    static void ForEachToken(const std::string &line, Function fn) {
+        auto it = line.begin();
+        while (it != line.end()) {
+            if (std::isspace(static_cast<unsigned char>(*it))) {
+                ++it;
+                continue;
+            }
+            auto end = it;
+            while (end != line.end() && !std::isspace(static_cast<unsigned char>(*end))) ++end;
+            fn(it, end);
+            it = end;
+        }
+    }
+
+    Vocabulary vocabulary;
+};
+
+}
+
+#endif //HARA_PREFIX_ENCODER_H
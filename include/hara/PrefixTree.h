@@ -4,7 +4,11 @@
 #include <vector>
 #include <map>
 #include <queue>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
 #include "Macros.h"
+#include "Stats.h"
 
 namespace hara {
 
@@ -14,6 +18,20 @@ class PrefixNode;
 template<typename Key, typename Value>
 class PrefixTree;
 
+/**
+ * Heap bytes of a PrefixTree, shallow: whatever a Key or Value owns itself is not counted
+ */
+struct PrefixTreeMemory {
+    // PrefixNode objects, the root included
+    size_t nodes = 0;
+    // std::map entries linking children to their parents, estimated from the usual red-black tree layout
+    size_t maps = 0;
+    // heap-allocated values of the leafs
+    size_t values = 0;
+
+    size_t Total() const { return nodes + maps + values; }
+};
+
 /**
  * wrapper around node pointer
  */
@@ -60,8 +78,14 @@ private:
 template<typename Key, typename Value>
 class PrefixNode {
 public:
+    // nodes own their children through raw pointers
+    PrefixNode(const PrefixNode &) = delete;
+
+    PrefixNode &operator=(const PrefixNode &) = delete;
+
     ~PrefixNode() {
         delete data;
+        DeleteChildren();
     }
 
     std::vector<Key> Prefix() const {
@@ -98,8 +122,8 @@ public:
         return leafs;
     }
 
-    bool Insert(const std::vector<Key> &keys, Value value) {
-        auto node = Find(keys, true);
+    bool Insert(const std::vector<Key> &keys, Value value, Counter &nodes_allocated) {
+        auto node = Find(keys, &nodes_allocated);
         if (node->data) return false;
         node->data = new Value{std::move(value)};
         while (node) {
@@ -143,24 +167,42 @@ private:
 
     bool IsRoot() const { return parent == nullptr; }
 
+    /**
+     * Delete every descendant without recursion, so that long keys cannot overflow the stack
+     */
+    void DeleteChildren() {
+        std::vector<PrefixNode *> stack;
+        for (auto &pair : children) stack.push_back(pair.second);
+        children.clear();
+        while (!stack.empty()) {
+            auto node = stack.back();
+            stack.pop_back();
+            for (auto &pair : node->children) stack.push_back(pair.second);
+            node->children.clear();
+            delete node;
+        }
+    }
+
     /**
      * Find the node relative to this by keys
-     * If create, construct node as you go
+     * If created is given, construct node as you go and count them
      */
-    PrefixNode *Find(const std::vector<Key> &keys, bool create = false) {
+    PrefixNode *Find(const std::vector<Key> &keys, Counter *created = nullptr) {
         auto node = this;
         for (auto &k : keys) {
             auto it = node->children.find(k);
             if (it == node->children.end()) {
-                if (create) it = node->children.emplace(k, new PrefixNode{node, k}).first;
-                else return nullptr;
+                if (!created) return nullptr;
+                it = node->children.emplace(k, new PrefixNode{node, k}).first;
+                created->Add();
             }
             node = it->second;
         }
         return node;
     }
 
-    PrefixNode *const parent;
+    // reassigned only for the children of a root moved to another tree
+    PrefixNode *parent;
     const Key key;
     std::map<Key, PrefixNode*> children;
     Value *data;
@@ -178,6 +220,34 @@ private:
 template<typename Key, typename Value>
 class PrefixTree {
 public:
+    PrefixTree() = default;
+
+    // nodes point to their parents, so a copy would have to rebuild every node
+    PrefixTree(const PrefixTree &) = delete;
+
+    PrefixTree &operator=(const PrefixTree &) = delete;
+
+    /**
+     * Take over the nodes of that, which is left empty
+     * Leafs found in that stay valid and belong to this tree, except one at the empty key
+     * Complexity: O(children of the root)
+     */
+    PrefixTree(PrefixTree &&that) noexcept: stats{that.stats} {
+        TakeNodes(that);
+    }
+
+    /**
+     * Free the nodes of this tree and take over those of that, which is left empty
+     * Complexity: O(nodes of this tree)
+     */
+    PrefixTree &operator=(PrefixTree &&that) noexcept {
+        if (this == &that) return *this;
+        Clear();
+        stats = that.stats;
+        TakeNodes(that);
+        return *this;
+    }
+
     /**
      * Return all leafs
      */
@@ -189,7 +259,7 @@ public:
      * Insert given value at the given keys
      */
     bool Insert(const std::vector<Key> &keys, Value value) {
-        return root.Insert(keys, std::move(value));
+        return root.Insert(keys, std::move(value), stats.nodes_allocated);
     }
 
     /**
@@ -197,14 +267,17 @@ public:
      * @return
      */
     bool Insert(PrefixLeaf<Key, Value> &leaf, const std::vector<Key> &keys, Value value) {
-        return leaf.node->Insert(keys, std::move(value));
+        return leaf.node->Insert(keys, std::move(value), stats.nodes_allocated);
     }
 
     /**
-     * Clear all leafs
+     * Clear all leafs and free every node but the root
+     * Complexity: O(nodes)
      */
     void Clear() {
-        root.children.clear();
+        root.DeleteChildren();
+        delete root.data;
+        root.data = nullptr;
         root.num_leafs = 0;
     }
 
@@ -217,6 +290,102 @@ public:
         leaf.node = nullptr;
     }
 
+    /**
+     * Erase the leaf at exactly keys; any PrefixLeaf held for it becomes invalid
+     * @return false if keys is not a leaf
+     * Complexity: O(length of keys)
+     */
+    bool Erase(const std::vector<Key> &keys) {
+        auto node = root.Find(keys);
+        if (!node || !node->data) return false;
+        node->Erase();
+        return true;
+    }
+
+    /**
+     * Value of the leaf at exactly keys, or nullptr if there is none
+     * Read-only; safe to call from several threads at once
+     * Complexity: O(length of keys)
+     */
+    const Value *Find(const std::vector<Key> &keys) const {
+        const PrefixNode<Key, Value> *node = &root;
+        for (const auto &k : keys) {
+            auto child = node->children.find(k);
+            if (child == node->children.end() || child->second->Empty()) return nullptr;
+            node = child->second;
+        }
+        return node->data;
+    }
+
+    /**
+     * Length of the longest prefix of [begin, end) with at least one leaf below it
+     * Read-only; safe to call from several threads at once
+     * Complexity: O(length of the match)
+     */
+    template<typename Iterator>
+    size_t LongestPrefix(Iterator begin, Iterator end) const {
+        const PrefixNode<Key, Value> *node = &root;
+        size_t length = 0;
+        for (auto it = begin; it != end; ++it, ++length) {
+            auto child = node->children.find(*it);
+            if (child == node->children.end() || child->second->Empty()) break;
+            node = child->second;
+        }
+        return length;
+    }
+
+    /**
+     * Length of the longest prefix of [begin, end) that is itself a leaf
+     * @param value set to that leaf's data, or nullptr if there is none
+     * Read-only; safe to call from several threads at once
+     * Complexity: O(length of the longest prefix)
+     */
+    template<typename Iterator>
+    size_t LongestMatch(Iterator begin, Iterator end, const Value *&value) const {
+        const PrefixNode<Key, Value> *node = &root;
+        size_t length = 0, matched = 0;
+        value = nullptr;
+        for (auto it = begin; it != end; ++it) {
+            auto child = node->children.find(*it);
+            if (child == node->children.end() || child->second->Empty()) break;
+            node = child->second;
+            ++length;
+            if (node->data) {
+                matched = length;
+                value = node->data;
+            }
+        }
+        return matched;
+    }
+
+    /**
+     * All leafs within Levenshtein distance max_distance of keys, closest first
+     * with ties in key order, each with its distance
+     *
+     * Walks the tree keeping one dynamic programming row per depth and skips subtrees
+     * whose row minimum already exceeds the bound; below a row whose minimum equals the bound
+     * only children matching the query are visited. With max_results the bound shrinks
+     * to the worst distance kept once that many leafs were found
+     * Complexity: O(max_distance * nodes visited)
+     */
+    std::vector<std::pair<PrefixLeaf<Key, Value>, size_t>>
+    FindWithin(const std::vector<Key> &keys, size_t max_distance, size_t max_results = SIZE_MAX) {
+        FuzzySearch search{keys, max_distance, max_results};
+        search.rows.emplace_back(keys.size() + 1);
+        for (size_t j = 0; j <= keys.size(); ++j) search.rows[0][j] = j;
+        if (!root.Empty() && max_results > 0) {
+            if (root.data && keys.size() <= max_distance) search.Add(&root, keys.size());
+            search.matches.emplace_back();
+            search.VisitChildren(&root, 0, 0);
+        }
+
+        std::sort(search.found.begin(), search.found.end());
+        std::vector<std::pair<PrefixLeaf<Key, Value>, size_t>> leafs;
+        for (const auto &found : search.found)
+            leafs.emplace_back(PrefixLeaf<Key, Value>{*search.nodes[found.second]}, found.first);
+        return leafs;
+    }
+
     /**
      * number of leafs in the tree
      */
@@ -224,8 +393,152 @@ public:
 
     bool Empty() const { return root.Empty(); }
 
+    /**
+     * Heap bytes held by the tree; nodes emptied by Erase still count until Clear
+     * Complexity: O(nodes)
+     */
+    PrefixTreeMemory MemoryUsage() const {
+        // a libstdc++ / libc++ map node: color, parent, left and right ahead of the entry
+        const size_t map_entry = 4 * sizeof(void *) + sizeof(std::pair<const Key, PrefixNode<Key, Value> *>);
+        PrefixTreeMemory memory;
+        memory.nodes = sizeof(root);
+        std::vector<const PrefixNode<Key, Value> *> stack{&root};
+        while (!stack.empty()) {
+            auto node = stack.back();
+            stack.pop_back();
+            if (node->data) memory.values += sizeof(Value);
+            memory.nodes += node->children.size() * sizeof(PrefixNode<Key, Value>);
+            memory.maps += node->children.size() * map_entry;
+            for (auto &pair : node->children) stack.push_back(pair.second);
+        }
+        return memory;
+    }
+
+    /**
+     * Counters of this tree; all zero unless built with HARA_STATS
+     */
+    const PrefixTreeStats &Stats() const { return stats; }
+
 private:
+    /**
+     * Move the children and data of the root of that, an empty tree, to this one
+     */
+    void TakeNodes(PrefixTree &that) {
+        root.children.swap(that.root.children);
+        for (auto &pair : root.children) pair.second->parent = &root;
+        root.data = that.root.data;
+        root.num_leafs = that.root.num_leafs;
+        that.root.data = nullptr;
+        that.root.num_leafs = 0;
+    }
+
+    /**
+     * State of FindWithin
+     */
+    struct FuzzySearch {
+        FuzzySearch(const std::vector<Key> &keys, size_t max_distance, size_t max_results)
+                : keys(keys), bound{max_distance}, max_results{max_results} {}
+
+        /**
+         * Search below node at depth, whose row has minimum min
+         * Once min reaches the bound, a child can only stay within it by matching the query
+         * at a cell holding the bound, so only those children are looked up instead of all of them
+         */
+        void VisitChildren(PrefixNode<Key, Value> *node, size_t depth, size_t min) {
+            if (min > bound) return;
+            if (rows.size() <= depth + 1) {
+                rows.emplace_back(keys.size() + 1);
+                matches.emplace_back();
+            }
+            if (min < bound) {
+                for (auto &pair : node->children) Visit(pair.first, pair.second, depth + 1);
+                return;
+            }
+
+            const auto &row = rows[depth];
+            auto &keys_matching = matches[depth];
+            keys_matching.clear();
+            const auto lo = depth + 1 > bound ? depth + 1 - bound : 1;
+            const auto hi = std::min(keys.size(), depth + 1 + bound);
+            for (size_t j = lo; j <= hi; ++j)
+                if (row[j - 1] == bound) keys_matching.push_back(keys[j - 1]);
+            // in key order, like a walk over the map, so ties still come out in key order
+            std::sort(keys_matching.begin(), keys_matching.end());
+            keys_matching.erase(std::unique(keys_matching.begin(), keys_matching.end()), keys_matching.end());
+            for (const auto &key : keys_matching) {
+                auto it = node->children.find(key);
+                if (it != node->children.end()) Visit(it->first, it->second, depth + 1);
+            }
+        }
+
+        /**
+         * Extend the row at depth by the key of child; the key is read from the map,
+         * so children pruned by their row are never dereferenced
+         */
+        void Visit(const Key &key, PrefixNode<Key, Value> *child, size_t depth) {
+            const auto min = Extend(depth, key);
+            if (min > bound || child->Empty()) return;
+            const auto distance = rows[depth][keys.size()];
+            if (child->data && distance <= bound) Add(child, distance);
+            VisitChildren(child, depth, min);
+        }
+
+        /**
+         * Fill the row at depth from the one above for key
+         * Only cells within bound of the diagonal can be within bound, so the rest are skipped
+         * @return minimum of the row, more than bound if every cell exceeds it
+         */
+        size_t Extend(size_t depth, const Key &key) {
+            const auto &prev = rows[depth - 1];
+            auto &row = rows[depth];
+            const auto m = keys.size();
+            const auto lo = depth > bound ? depth - bound : 1;
+            const auto hi = std::min(m, depth + bound);
+            if (lo > m) {
+                // the band is past the end of keys; only an empty query has a cell left
+                row[0] = depth;
+                return m == 0 ? depth : bound + 1;
+            }
+            // the cells just outside the band are read by the next depth, the last one by the caller
+            row[lo - 1] = lo == 1 ? depth : bound + 1;
+            if (hi < m) row[hi + 1] = row[m] = bound + 1;
+            auto min = row[lo - 1];
+            for (size_t j = lo; j <= hi; ++j) {
+                row[j] = std::min({prev[j] + 1, row[j - 1] + 1, prev[j - 1] + (keys[j - 1] == key ? 0 : 1)});
+                min = std::min(min, row[j]);
+            }
+            return min;
+        }
+
+        /**
+         * Keep the node unless max_results closer or earlier ones are kept already
+         */
+        void Add(PrefixNode<Key, Value> *node, size_t distance) {
+            found.emplace_back(distance, nodes.size());
+            std::push_heap(found.begin(), found.end());
+            nodes.push_back(node);
+            if (found.size() > max_results) {
+                std::pop_heap(found.begin(), found.end());
+                found.pop_back();
+            }
+            // once full, only strictly closer leafs can still make it
+            if (found.size() == max_results && found.front().first > 0)
+                bound = std::min(bound, found.front().first - 1);
+        }
+
+        const std::vector<Key> &keys;
+        size_t bound;
+        const size_t max_results;
+        std::vector<std::vector<size_t>> rows;
+        // per depth, query keys a child must match once the row minimum reached the bound
+        std::vector<std::vector<Key>> matches;
+        // max-heap of (distance, index in nodes); later nodes have larger keys
+        std::vector<std::pair<size_t, size_t>> found;
+        std::vector<PrefixNode<Key, Value> *> nodes;
+    };
+
     PrefixNode<Key, Value> root;
+    PrefixTreeStats stats;
 };
 
 }
@@ -5,7 +5,11 @@
 #include <queue>
 #include <set>
 #include <map>
+#include <algorithm>
+#include <iterator>
 #include "Macros.h"
+#include "PoolAllocator.h"
+#include "Stats.h"
 
 namespace hara {
 
@@ -32,6 +36,27 @@ public:
 
     void InsertOrUpdate(std::pair<K, V> pair) { impl->InsertOrUpdate(std::move(pair)); }
 
+    /**
+     * Insert or update every pair in [begin, end)
+     * later pairs win over earlier ones with the same key
+     */
+    template<typename Iterator>
+    void InsertOrUpdateMany(Iterator begin, Iterator end) { impl->InsertOrUpdateMany(begin, end); }
+
+    template<typename Range>
+    void InsertOrUpdateMany(const Range &range) { impl->InsertOrUpdateMany(std::begin(range), std::end(range)); }
+
+    /**
+     * Pop up to n top elements and append them to out in priority order
+     * @return number of elements popped
+     */
+    size_t PopN(size_t n, std::vector<std::pair<K, V>> &out) { return impl->PopN(n, out); }
+
+    /**
+     * Up to n top elements in priority order; the queue is left untouched
+     */
+    std::vector<std::pair<K, V>> TopN(size_t n) const { return impl->TopN(n); }
+
     void Erase(const K &key) { impl->Erase(key); }
 
     bool Contain(const K &key) const { return impl->Contain(key); }
@@ -45,6 +70,11 @@ public:
      */
     const V &Peek(const K &key) const { return impl->Peek(key); }
 
+    /**
+     * Counters of the backend; all zero unless built with HARA_STATS
+     */
+    const PriorityQueueStats &Stats() const { return impl->Stats(); }
+
 private:
     Impl *const impl;
 };
@@ -54,6 +84,7 @@ class PriorityQueueImpl {
 public:
     using Key = K;
     using Value = V;
+    using ValueCompare = Compare;
 
     virtual ~PriorityQueueImpl() = default;
 
@@ -67,6 +98,10 @@ public:
 
     virtual void InsertOrUpdate(std::pair<K, V> pair) = 0;
 
+    virtual size_t PopN(size_t n, std::vector<std::pair<K, V>> &out) = 0;
+
+    virtual std::vector<std::pair<K, V>> TopN(size_t n) const = 0;
+
     virtual void Erase(const K &key) = 0;
 
     virtual bool Contain(const K &key) const = 0;
@@ -75,7 +110,11 @@ public:
 
     virtual std::vector<Key> Keys() const = 0;
 
+    const PriorityQueueStats &Stats() const { return stats; }
+
 protected:
+    PriorityQueueStats stats;
+
     static inline bool less(const V &a, const V &b) { return Compare()(a, b); }
 
     static inline bool greater(const V &a, const V &b) { return less(b, a); }
@@ -84,6 +123,16 @@ protected:
 
     static inline bool notequal(const V &a, const V &b) { return !equal(a, b); }
 
+    /**
+     * Whether a batch of the given size is cheaper to apply by rebuilding
+     * the whole structure in O(size + batch) than by batch * O(lg(size)) updates
+     */
+    static inline bool PreferRebuild(size_t batch, size_t size) {
+        size_t lg = 1;
+        for (auto n = size + batch; n > 1; n >>= 1u) ++lg;
+        return batch * lg > size + batch;
+    }
+
     struct Pair {
         explicit Pair(std::pair<K, V> x) : x{std::move(x)} {}
 
@@ -119,11 +168,11 @@ public:
     PriorityQueueImpl1() = default;
 
     template<typename Iterator>
-    explicit PriorityQueueImpl1(Iterator begin, Iterator end)
-            : queue{begin, end} {
+    explicit PriorityQueueImpl1(Iterator begin, Iterator end) {
         for (auto it = begin; it != end; ++it) {
             valid.emplace(*it);
         }
+        Rebuild();
     }
 
     ~PriorityQueueImpl1() override = default;
@@ -133,16 +182,16 @@ public:
      */
     const std::pair<K, V> &Top() const override {
         ASSERT (!Empty(), "Queue is empty");
-        return queue.top().x;
+        return queue.front().x;
     }
 
     /**
-     * Complexity: Amortized O(1)
+     * Complexity: Amortized O(lg(N))
      */
     void Pop() override {
         if (Empty()) return;
-        valid.erase(queue.top().x.first);
-        queue.pop();
+        valid.erase(queue.front().x.first);
+        PopHeap();
         PopTillValid();
     }
 
@@ -157,12 +206,81 @@ public:
         auto it = valid.find(pair.first);
         if (it == valid.end())
             valid.emplace(pair);
+        else if (PriorityQueueImpl<K, V, Compare>::equal(it->second, pair.second))
+            // already in the heap as a valid element
+            return;
         else
             it->second = pair.second;
-        queue.emplace(std::move(pair));
+        queue.emplace_back(std::move(pair));
+        std::push_heap(queue.begin(), queue.end());
         PopTillValid();
     }
 
+    /**
+     * Requires forward iterators
+     * Complexity: O(M lg(N)) or O(N + M) with a full re-heapify, whichever is cheaper
+     */
+    template<typename Iterator>
+    void InsertOrUpdateMany(Iterator begin, Iterator end) {
+        const auto batch = static_cast<size_t>(std::distance(begin, end));
+        if (!PriorityQueueImpl<K, V, Compare>::PreferRebuild(batch, queue.size())) {
+            for (auto it = begin; it != end; ++it) InsertOrUpdate(*it);
+            return;
+        }
+        for (auto it = begin; it != end; ++it) {
+            auto found = valid.find(it->first);
+            if (found == valid.end()) valid.emplace(*it);
+            else found->second = it->second;
+        }
+        // also drops every spurious element accumulated so far
+        Rebuild();
+    }
+
+    /**
+     * Complexity: O(M lg(N)), or O(N lg(N)) with a single sort when draining the queue
+     */
+    size_t PopN(size_t n, std::vector<std::pair<K, V>> &out) override {
+        n = std::min(n, Size());
+        out.reserve(out.size() + n);
+        if (n == Size()) {
+            const auto first = out.size();
+            for (const auto &pair : valid) out.push_back(pair);
+            std::sort(out.begin() + first, out.end(),
+                      [](const std::pair<K, V> &a, const std::pair<K, V> &b) { return Pair{a} > Pair{b}; });
+            valid.clear();
+            queue.clear();
+            return n;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            out.push_back(queue.front().x);
+            Pop();
+        }
+        return n;
+    }
+
+    /**
+     * Best-first walk over the heap array; no element is moved
+     * A key whose value went back to an earlier one has several valid copies, only the first counts
+     * Complexity: O(M lg(M) lg(N)) plus spurious elements visited
+     */
+    std::vector<std::pair<K, V>> TopN(size_t n) const override {
+        std::vector<std::pair<K, V>> top;
+        n = std::min(n, Size());
+        top.reserve(n);
+        auto cmp = [this](size_t a, size_t b) { return queue[a] < queue[b]; };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(cmp)> frontier{cmp};
+        std::set<K> emitted;
+        if (!queue.empty()) frontier.push(0);
+        while (top.size() < n && !frontier.empty()) {
+            const auto idx = frontier.top();
+            frontier.pop();
+            if (IsValid(queue[idx]) && emitted.insert(queue[idx].x.first).second) top.push_back(queue[idx].x);
+            for (auto child = 2 * idx + 1; child <= 2 * idx + 2 && child < queue.size(); ++child)
+                frontier.push(child);
+        }
+        return top;
+    }
+
     /**
      * Complexity: O(lg(N))
      */
@@ -196,22 +314,47 @@ public:
     const V &Peek(const K &key) const override { return valid.at(key); }
 
 private:
+    using Pair = typename PriorityQueueImpl<K, V, Compare>::Pair;
+
+    bool IsValid(const Pair &pair) const {
+        auto it = valid.find(pair.x.first);
+        return it != valid.end()
+               && PriorityQueueImpl<K, V, Compare>::equal(it->second, pair.x.second);
+    }
+
+    void PopHeap() {
+        std::pop_heap(queue.begin(), queue.end());
+        queue.pop_back();
+    }
+
     /**
      * Complexity: Amortized O(1)
      */
     void PopTillValid() {
         while (!queue.empty()) {
-            auto it = valid.find(queue.top().x.first);
-            if (it == valid.end()
-                || PriorityQueueImpl<K, V, Compare>::notequal(it->second, queue.top().x.second))
+            if (!IsValid(queue.front())) {
                 // this is a spurious element
-                queue.pop();
-            else break;
+                PopHeap();
+                this->stats.stale_pops.Add();
+            } else break;
         }
     }
 
-    using Pair = typename PriorityQueueImpl<K, V, Compare>::Pair;
-    std::priority_queue<Pair> queue;
+    /**
+     * Re-heapify from valid elements only
+     * Complexity: O(N)
+     */
+    void Rebuild() {
+        this->stats.rebalances.Add();
+        ScopedTimer timer{this->stats.rebalance_ns};
+        queue.clear();
+        queue.reserve(valid.size());
+        for (const auto &pair : valid) queue.emplace_back(pair);
+        std::make_heap(queue.begin(), queue.end());
+    }
+
+    // binary max-heap maintained with std::push_heap / std::pop_heap
+    std::vector<Pair> queue;
     std::map<K, V> valid;
 };
 
@@ -265,6 +408,59 @@ public:
         }
     }
 
+    /**
+     * Requires forward iterators
+     * Complexity: O(M lg(N)), or O(N lg(N)) with a single sort and a linear
+     * hinted rebuild when the batch is at least as large as the queue
+     */
+    template<typename Iterator>
+    void InsertOrUpdateMany(Iterator begin, Iterator end) {
+        const auto batch = static_cast<size_t>(std::distance(begin, end));
+        if (batch < Size()) {
+            for (auto it = begin; it != end; ++it) InsertOrUpdate(*it);
+            return;
+        }
+        for (auto it = begin; it != end; ++it) {
+            auto found = valid.find(it->first);
+            if (found == valid.end()) valid.emplace(*it);
+            else found->second = it->second;
+        }
+        this->stats.rebalances.Add();
+        ScopedTimer timer{this->stats.rebalance_ns};
+        std::vector<Pair> sorted;
+        sorted.reserve(valid.size());
+        for (const auto &pair : valid) sorted.emplace_back(pair);
+        std::sort(sorted.begin(), sorted.end(), std::greater<Pair>());
+        set.clear();
+        for (auto &pair : sorted) set.emplace_hint(set.end(), std::move(pair));
+    }
+
+    /**
+     * Complexity: O(M lg(N)) with a single range erase on the set
+     */
+    size_t PopN(size_t n, std::vector<std::pair<K, V>> &out) override {
+        n = std::min(n, Size());
+        out.reserve(out.size() + n);
+        auto last = set.begin();
+        for (size_t i = 0; i < n; ++i, ++last) {
+            out.push_back(last->x);
+            valid.erase(last->x.first);
+        }
+        set.erase(set.begin(), last);
+        return n;
+    }
+
+    /**
+     * Complexity: O(M)
+     */
+    std::vector<std::pair<K, V>> TopN(size_t n) const override {
+        std::vector<std::pair<K, V>> top;
+        n = std::min(n, Size());
+        top.reserve(n);
+        for (auto it = set.begin(); top.size() < n; ++it) top.push_back(it->x);
+        return top;
+    }
+
     /**
      * Complexity: O(lg(N))
      */
@@ -299,8 +495,245 @@ public:
 
 private:
     using Pair = typename PriorityQueueImpl<K, V, Compare>::Pair;
-    std::set<Pair, std::greater<Pair>> set;
-    std::map<K, V> valid;
+    // nodes are recycled through per-container pools, so updating an existing key
+    // (erase + emplace on the set) does not go through malloc / free;
+    // pooled memory is only released when the queue is destroyed
+    std::set<Pair, std::greater<Pair>, PoolAllocator<Pair>> set;
+    std::map<K, V, std::less<K>, PoolAllocator<std::pair<const K, V>>> valid;
+};
+
+/**
+ * Pairing heap with nodes addressed through the key index
+ * Moving a key towards the top is a cut and a meld with the root in O(1);
+ * moving it away from the top cuts it, merges its children and reinserts it
+ * @tparam K
+ * @tparam V
+ */
+template<typename K, typename V, typename Compare = std::less<V>>
+class PriorityQueueImpl3 : public PriorityQueueImpl<K, V, Compare> {
+public:
+    PriorityQueueImpl3() : root{nullptr} {}
+
+    template<typename Iterator>
+    explicit PriorityQueueImpl3(Iterator begin, Iterator end) : root{nullptr} {
+        InsertOrUpdateMany(begin, end);
+    }
+
+    ~PriorityQueueImpl3() override {
+        for (auto &pair : index) DeleteNode(pair.second);
+    }
+
+    /**
+     * Complexity: O(1)
+     */
+    const std::pair<K, V> &Top() const override {
+        ASSERT (!Empty(), "Queue is empty");
+        return root->pair.x;
+    }
+
+    /**
+     * Complexity: Amortized O(lg(N))
+     */
+    void Pop() override {
+        if (Empty()) return;
+        Remove(root);
+    }
+
+    bool Empty() const override { return root == nullptr; }
+
+    size_t Size() const override { return index.size(); }
+
+    /**
+     * Complexity: O(lg(N)) for the key lookup;
+     * O(1) heap work for an insert or a move towards the top,
+     * amortized O(lg(N)) for a move away from the top
+     */
+    void InsertOrUpdate(std::pair<K, V> pair) override {
+        auto it = index.find(pair.first);
+        if (it == index.end()) {
+            auto node = NewNode(std::move(pair));
+            index.emplace(node->pair.x.first, node);
+            root = Meld(root, node);
+            return;
+        }
+        auto node = it->second;
+        if (PriorityQueueImpl<K, V, Compare>::equal(node->pair.x.second, pair.second)) return;
+        const bool better = PriorityQueueImpl<K, V, Compare>::greater(pair.second, node->pair.x.second);
+        node->pair.x.second = std::move(pair.second);
+        if (better) {
+            if (node == root) return;
+            Cut(node);
+            root = Meld(root, node);
+        } else {
+            auto children = node->child;
+            node->child = nullptr;
+            if (node == root) root = nullptr;
+            else Cut(node);
+            root = Meld(root, Meld(MergePairs(children), node));
+        }
+    }
+
+    /**
+     * Inserts are already O(1) melds, so a batch is applied element by element
+     * Complexity: O(M lg(N))
+     */
+    template<typename Iterator>
+    void InsertOrUpdateMany(Iterator begin, Iterator end) {
+        for (auto it = begin; it != end; ++it) InsertOrUpdate(*it);
+    }
+
+    /**
+     * Complexity: Amortized O(M lg(N))
+     */
+    size_t PopN(size_t n, std::vector<std::pair<K, V>> &out) override {
+        n = std::min(n, Size());
+        out.reserve(out.size() + n);
+        for (size_t i = 0; i < n; ++i) {
+            out.push_back(root->pair.x);
+            Remove(root);
+        }
+        return n;
+    }
+
+    /**
+     * Best-first walk over the heap; no node is moved
+     * Complexity: O(M lg(M)) plus the children of every visited node
+     */
+    std::vector<std::pair<K, V>> TopN(size_t n) const override {
+        std::vector<std::pair<K, V>> top;
+        n = std::min(n, Size());
+        top.reserve(n);
+        auto cmp = [](const Node *a, const Node *b) { return a->pair < b->pair; };
+        std::priority_queue<const Node *, std::vector<const Node *>, decltype(cmp)> frontier{cmp};
+        if (root) frontier.push(root);
+        while (top.size() < n) {
+            const auto node = frontier.top();
+            frontier.pop();
+            top.push_back(node->pair.x);
+            for (auto child = node->child; child; child = child->next) frontier.push(child);
+        }
+        return top;
+    }
+
+    /**
+     * Complexity: Amortized O(lg(N))
+     */
+    void Erase(const K &key) override {
+        auto it = index.find(key);
+        if (it == index.end()) return;
+        Remove(it->second);
+    }
+
+    /**
+     * Complexity: O(lg(N))
+     */
+    bool Contain(const K &key) const override {
+        return index.find(key) != index.end();
+    }
+
+    /**
+    * Complexity: O(N)
+    */
+    std::vector<K> Keys() const override {
+        std::vector<K> keys;
+        for (const auto &pair : index) keys.push_back(pair.first);
+        return keys;
+    }
+
+    /**
+     * Complexity: O(lg(N))
+     */
+    const V &Peek(const K &key) const override { return index.at(key)->pair.x.second; }
+
+private:
+    using Pair = typename PriorityQueueImpl<K, V, Compare>::Pair;
+
+    /**
+     * left-child right-sibling node;
+     * prev is the parent for a leftmost child and the left sibling otherwise
+     */
+    struct Node {
+        explicit Node(std::pair<K, V> x)
+                : pair{std::move(x)}, child{nullptr}, next{nullptr}, prev{nullptr} {}
+
+        Pair pair;
+        Node *child;
+        Node *next;
+        Node *prev;
+    };
+
+    Node *NewNode(std::pair<K, V> x) {
+        return new(pool.Allocate(sizeof(Node))) Node{std::move(x)};
+    }
+
+    void DeleteNode(Node *node) {
+        node->~Node();
+        pool.Deallocate(node, sizeof(Node));
+    }
+
+    /**
+     * Meld two detached heaps; the worse root becomes the leftmost child of the better one
+     */
+    static Node *Meld(Node *a, Node *b) {
+        if (!a) return b;
+        if (!b) return a;
+        if (a->pair < b->pair) std::swap(a, b);
+        b->prev = a;
+        b->next = a->child;
+        if (a->child) a->child->prev = b;
+        a->child = b;
+        a->next = a->prev = nullptr;
+        return a;
+    }
+
+    /**
+     * Detach a non-root node together with its subtree
+     */
+    static void Cut(Node *node) {
+        if (node->prev->child == node) node->prev->child = node->next;
+        else node->prev->next = node->next;
+        if (node->next) node->next->prev = node->prev;
+        node->next = node->prev = nullptr;
+    }
+
+    /**
+     * Standard two-pass merge of a sibling list: pairwise left to right, then fold right to left
+     */
+    Node *MergePairs(Node *first) {
+        if (!first) return nullptr;
+        merged.clear();
+        while (first) {
+            auto a = first;
+            auto b = a->next;
+            first = b ? b->next : nullptr;
+            a->next = a->prev = nullptr;
+            if (b) b->next = b->prev = nullptr;
+            merged.push_back(Meld(a, b));
+        }
+        auto result = merged.back();
+        for (auto idx = merged.size() - 1; idx-- > 0;)
+            result = Meld(merged[idx], result);
+        return result;
+    }
+
+    void Remove(Node *node) {
+        auto children = node->child;
+        node->child = nullptr;
+        if (node == root) {
+            root = MergePairs(children);
+        } else {
+            Cut(node);
+            root = Meld(root, MergePairs(children));
+        }
+        index.erase(node->pair.x.first);
+        DeleteNode(node);
+    }
+
+    Node *root;
+    NodePool pool;
+    std::map<K, Node *, std::less<K>, PoolAllocator<std::pair<const K, Node *>>> index;
+    // scratch space for MergePairs
+    std::vector<Node *> merged;
 };
 
 template<typename K, typename V, typename C = std::less<V>>
@@ -309,6 +742,9 @@ using PriorityQueue1 = PriorityQueue<PriorityQueueImpl1<K, V, C>>;
 template<typename K, typename V, typename C = std::less<V>>
 using PriorityQueue2 = PriorityQueue<PriorityQueueImpl2<K, V, C>>;
 
+template<typename K, typename V, typename C = std::less<V>>
+using PriorityQueue3 = PriorityQueue<PriorityQueueImpl3<K, V, C>>;
+
 }
 
 #endif //HARA_PRIORITY_QUEUE_H
@@ -0,0 +1,350 @@
+#ifndef HARA_RECORD_READER_H
+#define HARA_RECORD_READER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Input.h"
+#include "Number.h"
+#include "StringView.h"
+#include "Macros.h"
+
+namespace hara {
+
+enum class ColumnType {
+    String, Int, Float
+};
+
+/**
+ * Rows of the projected columns of a RecordReader, one typed buffer per column
+ * Buffers keep their capacity from one batch to the next
+ */
+class ColumnBatch {
+public:
+    explicit ColumnBatch(std::vector<ColumnType> types)
+            : types{std::move(types)}, strings(this->types.size()), ints(this->types.size()),
+              floats(this->types.size()), num_rows{0} {}
+
+    size_t NumRows() const { return num_rows; }
+
+    size_t NumColumns() const { return types.size(); }
+
+    ColumnType Type(size_t column) const { return types[column]; }
+
+    const std::vector<std::string> &Strings(size_t column) const {
+        ASSERT(types[column] == ColumnType::String, "Not a string column");
+        return strings[column];
+    }
+
+    const std::vector<int64_t> &Ints(size_t column) const {
+        ASSERT(types[column] == ColumnType::Int, "Not an int column");
+        return ints[column];
+    }
+
+    const std::vector<double> &Floats(size_t column) const {
+        ASSERT(types[column] == ColumnType::Float, "Not a float column");
+        return floats[column];
+    }
+
+private:
+    void Clear() {
+        for (auto &column : ints) column.clear();
+        for (auto &column : floats) column.clear();
+        num_rows = 0;
+    }
+
+    /**
+     * Drop strings left over from a longer previous batch
+     */
+    void Finish() {
+        for (size_t column = 0; column < types.size(); ++column)
+            if (types[column] == ColumnType::String) strings[column].resize(num_rows);
+    }
+
+    const std::vector<ColumnType> types;
+    std::vector<std::vector<std::string>> strings;
+    std::vector<std::vector<int64_t>> ints;
+    std::vector<std::vector<double>> floats;
+    size_t num_rows;
+
+    friend class RecordReader;
+};
+
+/**
+ * Delimited records (TSV, CSV) of an Input, projected onto a fixed set of columns
+ *
+ * Each record is only scanned as far as the last projected column, and fields are returned as views
+ * into the line, so no field is copied unless it is quoted with "" escapes in it.
+ * In quoted mode fields may be enclosed in double quotes (RFC 4180) and then contain delimiters,
+ * line breaks and "" for a quote; malformed quoting throws. Records may end in CRLF there
+ */
+class RecordReader {
+public:
+    struct Options {
+        char delimiter = '\t';
+        bool quoted = false;
+    };
+
+    static Options Tsv() { return Options{}; }
+
+    static Options Csv() {
+        Options options;
+        options.delimiter = ',';
+        options.quoted = true;
+        return options;
+    }
+
+    /**
+     * @param columns 0-based column indices, in the order fields are returned
+     */
+    RecordReader(Input &input, const std::vector<size_t> &columns, Options options)
+            : input(input), options(options), num_records{0} {
+        Project(columns);
+    }
+
+    RecordReader(Input &input, const std::vector<size_t> &columns) : RecordReader{input, columns, Tsv()} {}
+
+    /**
+     * Project by column names, looked up in the header record which is consumed here
+     */
+    RecordReader(Input &input, const std::vector<std::string> &names, Options options)
+            : input(input), options(options), num_records{0} {
+        std::vector<size_t> columns;
+        Project({});
+        ASSERT(Scan(SIZE_MAX, &header), "Missing header");
+        for (const auto &name : names) {
+            const auto it = std::find(header.begin(), header.end(), name);
+            ASSERT(it != header.end(), "No column named " + name);
+            columns.push_back(static_cast<size_t>(it - header.begin()));
+        }
+        Project(columns);
+    }
+
+    RecordReader(Input &input, const std::vector<std::string> &names) : RecordReader{input, names, Tsv()} {}
+
+    /**
+     * Read the next record
+     * @return false at the end of the input
+     */
+    bool Next() {
+        if (!Scan(max_column, nullptr)) return false;
+        ++num_records;
+        return true;
+    }
+
+    /**
+     * Field of the idx-th projected column in the current record; empty if the record is too short
+     * Valid until the next call to Next
+     */
+    StringView Field(size_t idx) const {
+        const auto &field = fields[idx];
+        return {(field.unescaped ? scratch.data() : line.data()) + field.offset, field.size};
+    }
+
+    /**
+     * Whether the current record has the idx-th projected column
+     */
+    bool Has(size_t idx) const { return fields[idx].present; }
+
+    size_t NumColumns() const { return fields.size(); }
+
+    /**
+     * Records read so far, excluding the header
+     */
+    size_t NumRecords() const { return num_records; }
+
+    /**
+     * Column names when projecting by name
+     */
+    const std::vector<std::string> &Header() const { return header; }
+
+    /**
+     * Read up to max_rows records into batch, whose column types follow the projection
+     * Numeric fields that are missing or malformed throw
+     * @return number of rows read, 0 at the end of the input
+     */
+    size_t NextBatch(ColumnBatch &batch, size_t max_rows) {
+        ASSERT(batch.NumColumns() == NumColumns(), "Batch does not match the projection");
+        batch.Clear();
+        while (batch.num_rows < max_rows && Next()) {
+            for (size_t idx = 0; idx < fields.size(); ++idx) {
+                const auto field = Field(idx);
+                switch (batch.types[idx]) {
+                    case ColumnType::String: {
+                        auto &column = batch.strings[idx];
+                        if (column.size() <= batch.num_rows) column.emplace_back();
+                        column[batch.num_rows].assign(field.data(), field.size());
+                        break;
+                    }
+                    case ColumnType::Int:
+                        batch.ints[idx].push_back(Parse<int64_t>("integer", field, idx));
+                        break;
+                    case ColumnType::Float:
+                        batch.floats[idx].push_back(Parse<double>("float", field, idx));
+                        break;
+                }
+            }
+            ++batch.num_rows;
+        }
+        batch.Finish();
+        return batch.num_rows;
+    }
+
+private:
+    struct Slice {
+        size_t offset;
+        size_t size;
+        // offset into scratch rather than line
+        bool unescaped;
+        bool present;
+    };
+
+    void Project(const std::vector<size_t> &columns) {
+        fields.assign(columns.size(), Slice{0, 0, false, false});
+        slots.clear();
+        for (size_t idx = 0; idx < columns.size(); ++idx) slots.emplace_back(columns[idx], idx);
+        std::sort(slots.begin(), slots.end());
+        max_column = slots.empty() ? 0 : slots.back().first;
+    }
+
+    /**
+     * Read one record, locating projected fields up to column last
+     * If all is given, every field is copied into it instead
+     */
+    bool Scan(size_t last, std::vector<std::string> *all) {
+        if (!GetLine(line, crlf)) return false;
+        scratch.clear();
+        for (auto &field : fields) field = Slice{0, 0, false, false};
+        if (all) all->clear();
+
+        auto slot = slots.begin();
+        size_t pos = 0;
+        for (size_t column = 0; column <= last; ++column) {
+            Slice field{pos, 0, false, true};
+            size_t end;
+            if (options.quoted && pos < line.size() && line[pos] == '"') {
+                end = ScanQuoted(pos, field, all != nullptr || (slot != slots.end() && slot->first == column));
+            } else {
+                auto p = static_cast<const char *>(std::memchr(line.data() + pos, options.delimiter, line.size() - pos));
+                end = p ? static_cast<size_t>(p - line.data()) : line.size();
+                field.size = end - pos;
+            }
+
+            if (all) all->emplace_back((field.unescaped ? scratch.data() : line.data()) + field.offset, field.size);
+            for (; slot != slots.end() && slot->first == column; ++slot) fields[slot->second] = field;
+
+            if (end == line.size()) return true;
+            pos = end + 1;
+        }
+
+        // a quoted field further on may still span lines
+        if (options.quoted && std::memchr(line.data() + pos, '"', line.size() - pos))
+            SkipRest(pos);
+        return true;
+    }
+
+    /**
+     * Parse the quoted field starting at pos, reading more lines while the quote is open
+     * @param keep whether to unescape "" into scratch
+     * @return position of the delimiter after the field or line.size()
+     */
+    size_t ScanQuoted(size_t pos, Slice &field, bool keep) {
+        size_t begin = pos + 1, it = begin;
+        bool escaped = false;
+        while (true) {
+            auto quote = line.find('"', it);
+            if (quote == std::string::npos) {
+                std::string next;
+                bool next_crlf;
+                ASSERT(GetLine(next, next_crlf),
+                       "Unterminated quoted field in record " + std::to_string(num_records + 1));
+                // the line break is part of the field
+                line.append(crlf ? "\r\n" : "\n");
+                crlf = next_crlf;
+                it = line.size();
+                line += next;
+                continue;
+            }
+            if (quote + 1 < line.size() && line[quote + 1] == '"') {
+                escaped = true;
+                it = quote + 2;
+                continue;
+            }
+            ASSERT(quote + 1 == line.size() || line[quote + 1] == options.delimiter,
+                   "Malformed quoted field in record " + std::to_string(num_records + 1));
+            field.offset = begin;
+            field.size = quote - begin;
+            if (escaped && keep) {
+                field.offset = scratch.size();
+                for (auto i = begin; i < quote; ++i) {
+                    scratch.push_back(line[i]);
+                    if (line[i] == '"') ++i;
+                }
+                field.size = scratch.size() - field.offset;
+                field.unescaped = true;
+            }
+            return quote + 1;
+        }
+    }
+
+    /**
+     * Read one physical line, without the CR of a CRLF in quoted mode
+     */
+    bool GetLine(std::string &to, bool &cr) {
+        if (!input.GetLine(to)) return false;
+        cr = options.quoted && !to.empty() && to.back() == '\r';
+        if (cr) to.pop_back();
+        return true;
+    }
+
+    /**
+     * Consume the fields after the projection, only to find where the record ends
+     */
+    void SkipRest(size_t pos) {
+        Slice field{0, 0, false, false};
+        while (pos < line.size()) {
+            size_t end;
+            if (line[pos] == '"') {
+                end = ScanQuoted(pos, field, false);
+            } else {
+                end = line.find(options.delimiter, pos);
+                if (end == std::string::npos) end = line.size();
+            }
+            pos = end + 1;
+        }
+    }
+
+    template<typename T>
+    T Parse(const char *type, StringView field, size_t idx) const {
+        T value{};
+        const auto result = Number::Parse(field.begin(), field.end(), value);
+        ASSERT(result.error == Number::Error::None && result.ptr == field.end(), Malformed(type, field, idx));
+        return value;
+    }
+
+    std::string Malformed(const char *type, StringView field, size_t idx) const {
+        return "Malformed " + std::string{type} + " '" + field.ToString() + "' in column #" + std::to_string(idx) +
+               " of record " + std::to_string(num_records);
+    }
+
+    Input &input;
+    const Options options;
+    // (column, index in the projection), sorted by column
+    std::vector<std::pair<size_t, size_t>> slots;
+    size_t max_column;
+    std::vector<Slice> fields;
+    std::vector<std::string> header;
+    std::string line;
+    // whether the last physical line of the record ended in CRLF
+    bool crlf = false;
+    // unescaped quoted fields of the current record
+    std::string scratch;
+    size_t num_records;
+};
+
+}
+
+#endif //HARA_RECORD_READER_H
@@ -0,0 +1,143 @@
+#ifndef HARA_STATS_H
+#define HARA_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+namespace hara {
+
+/**
+ * Instrumentation counters
+ *
+ * Compiled in only with HARA_STATS defined;
+ * otherwise every counter and timer is an empty no-op and reads as 0
+ */
+#ifdef HARA_STATS
+
+constexpr bool STATS_ENABLED = true;
+
+/**
+ * Per-instance counter with a single writer
+ * Relaxed load + store instead of a locked fetch_add,
+ * while still safe to read from another thread for monitoring
+ */
+class Counter {
+public:
+    Counter() : value{0} {}
+
+    // copies take a snapshot
+    Counter(const Counter &that) : value{that.Get()} {}
+
+    Counter &operator=(const Counter &that) {
+        value.store(that.Get(), std::memory_order_relaxed);
+        return *this;
+    }
+
+    void Add(uint64_t n = 1) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value;
+};
+
+/**
+ * Add the lifetime of the scope in ns to a counter
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Counter &counter)
+            : counter{counter}, start{std::chrono::steady_clock::now()} {}
+
+    ~ScopedTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        counter.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+private:
+    Counter &counter;
+    const std::chrono::steady_clock::time_point start;
+};
+
+#else
+
+constexpr bool STATS_ENABLED = false;
+
+class Counter {
+public:
+    void Add(uint64_t = 1) {}
+
+    uint64_t Get() const { return 0; }
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Counter &) {}
+};
+
+#endif
+
+/**
+ * Render name/value pairs as a flat JSON object
+ */
+inline std::string ToJson(std::initializer_list<std::pair<const char *, uint64_t>> values) {
+    std::string json{"{"};
+    for (const auto &pair : values) {
+        if (json.size() > 1) json.append(", ");
+        json.append("\"").append(pair.first).append("\": ").append(std::to_string(pair.second));
+    }
+    return json.append("}");
+}
+
+struct InputStats {
+    Counter bytes_read;
+    Counter lines;
+
+    std::string ToJson() const {
+        return hara::ToJson({{"bytes_read", bytes_read.Get()},
+                             {"lines",      lines.Get()}});
+    }
+};
+
+struct OutputStats {
+    Counter bytes_written;
+    // lines ended by WriteLine or std::endl
+    Counter lines;
+    Counter flushes;
+
+    std::string ToJson() const {
+        return hara::ToJson({{"bytes_written", bytes_written.Get()},
+                             {"lines",         lines.Get()},
+                             {"flushes",       flushes.Get()}});
+    }
+};
+
+struct PrefixTreeStats {
+    Counter nodes_allocated;
+
+    std::string ToJson() const {
+        return hara::ToJson({{"nodes_allocated", nodes_allocated.Get()}});
+    }
+};
+
+struct PriorityQueueStats {
+    // spurious elements discarded from the top of a lazily invalidated heap
+    Counter stale_pops;
+    // full rebuilds of the backing structure
+    Counter rebalances;
+    Counter rebalance_ns;
+
+    std::string ToJson() const {
+        return hara::ToJson({{"stale_pops",   stale_pops.Get()},
+                             {"rebalances",   rebalances.Get()},
+                             {"rebalance_ns", rebalance_ns.Get()}});
+    }
+};
+
+}
+
+#endif //HARA_STATS_H
@@ -0,0 +1,85 @@
+#ifndef HARA_STRING_VIEW_H
+#define HARA_STRING_VIEW_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace hara {
+
+/**
+ * Non-owning view of a char range, for C++11 code without std::string_view
+ * The viewed storage must outlive the view
+ */
+class StringView {
+public:
+    StringView() : ptr{nullptr}, length{0} {}
+
+    StringView(const char *data, size_t size) : ptr{data}, length{size} {}
+
+    StringView(const std::string &s) : ptr{s.data()}, length{s.size()} {}
+
+    StringView(const char *s) : ptr{s}, length{std::strlen(s)} {}
+
+    const char *data() const { return ptr; }
+
+    size_t size() const { return length; }
+
+    bool empty() const { return length == 0; }
+
+    const char *begin() const { return ptr; }
+
+    const char *end() const { return ptr + length; }
+
+    char operator[](size_t idx) const { return ptr[idx]; }
+
+    StringView substr(size_t pos, size_t n = std::string::npos) const {
+        pos = std::min(pos, length);
+        return {ptr + pos, std::min(n, length - pos)};
+    }
+
+    std::string ToString() const { return {ptr, length}; }
+
+    bool operator==(const StringView &that) const {
+        return length == that.length && (length == 0 || std::memcmp(ptr, that.ptr, length) == 0);
+    }
+
+    bool operator!=(const StringView &that) const { return !(*this == that); }
+
+    bool operator<(const StringView &that) const {
+        const auto cmp = std::memcmp(ptr, that.ptr, std::min(length, that.length));
+        return cmp < 0 || (cmp == 0 && length < that.length);
+    }
+
+private:
+    const char *ptr;
+    size_t length;
+};
+
+inline std::ostream &operator<<(std::ostream &os, const StringView &view) {
+    return os.write(view.data(), view.size());
+}
+
+}
+
+namespace std {
+
+template<>
+struct hash<hara::StringView> {
+    size_t operator()(const hara::StringView &view) const {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ull;
+        for (auto c : view) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ull;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+}
+
+#endif //HARA_STRING_VIEW_H
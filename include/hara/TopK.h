@@ -0,0 +1,211 @@
+#ifndef HARA_TOPK_H
+#define HARA_TOPK_H
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "Macros.h"
+
+namespace hara {
+
+/**
+ * Fixed-capacity tracker of the K best (key, value) pairs out of a stream of updates
+ * Same InsertOrUpdate / Erase / Contain / Peek surface as PriorityQueue
+ *
+ * Only the K resident pairs are kept, in a min-heap indexed by key,
+ * so the admission threshold (the K-th best pair) is available in O(1).
+ * A key that falls out of the top K is forgotten, and only the best forgotten pair is remembered.
+ * For streams where values only improve (e.g. counts) the result is exact.
+ * A resident key updated below the best forgotten pair is evicted, since a forgotten key
+ * would now rank above it; from then on, as after erasing while keys were forgotten,
+ * the resident pairs may no longer be the true top K and Exact() turns false
+ *
+ * Ordering ties are broken by key exactly like PriorityQueue
+ */
+template<typename K, typename V, typename Compare = std::less<V>>
+class TopK {
+public:
+    explicit TopK(size_t capacity) : capacity{capacity}, exact{true} {
+        ASSERT(capacity > 0, "Capacity must be positive");
+        heap.reserve(capacity);
+        index.reserve(capacity);
+    }
+
+    /**
+     * Complexity: O(1) to reject a non-competitive pair, otherwise O(lg(K))
+     * @return whether the key is resident afterwards
+     */
+    bool InsertOrUpdate(std::pair<K, V> pair) {
+        auto it = index.find(pair.first);
+        if (it != index.end()) {
+            const auto pos = it->second;
+            const bool better = Higher(pair, heap[pos]);
+            if (!better && !best_forgotten.empty() && Higher(best_forgotten.front(), pair)) {
+                Erase(pair.first);
+                Forget(std::move(pair));
+                exact = false;
+                return false;
+            }
+            // resident key; a worse value just sinks towards the threshold
+            heap[pos].second = std::move(pair.second);
+            if (better) SiftDown(pos);
+            else SiftUp(pos);
+            return true;
+        }
+        if (heap.size() < capacity) {
+            index.emplace(pair.first, heap.size());
+            heap.push_back(std::move(pair));
+            SiftUp(heap.size() - 1);
+            return true;
+        }
+        if (!Higher(pair, heap.front())) {
+            Forget(std::move(pair));
+            return false;
+        }
+        // evict the current threshold
+        Forget(heap.front());
+        index.erase(heap.front().first);
+        index.emplace(pair.first, 0);
+        heap.front() = std::move(pair);
+        SiftDown(0);
+        return true;
+    }
+
+    /**
+     * Complexity: O(lg(K))
+     */
+    void Erase(const K &key) {
+        auto it = index.find(key);
+        if (it == index.end()) return;
+        // a forgotten key may belong in the freed slot
+        if (!best_forgotten.empty()) exact = false;
+        const auto pos = it->second;
+        index.erase(it);
+        if (pos + 1 == heap.size()) {
+            heap.pop_back();
+            return;
+        }
+        heap[pos] = std::move(heap.back());
+        heap.pop_back();
+        index[heap[pos].first] = pos;
+        SiftUp(pos);
+        SiftDown(pos);
+    }
+
+    /**
+     * Complexity: O(1)
+     */
+    bool Contain(const K &key) const { return index.find(key) != index.end(); }
+
+    /**
+     * throws exception if key not resident
+     * Complexity: O(1)
+     */
+    const V &Peek(const K &key) const { return heap[index.at(key)].second; }
+
+    /**
+     * The worst resident pair, i.e. the bar a new key has to beat once full
+     * Complexity: O(1)
+     */
+    const std::pair<K, V> &Min() const {
+        ASSERT(!Empty(), "TopK is empty");
+        return heap.front();
+    }
+
+    /**
+     * Resident pairs, best first
+     * Complexity: O(K lg(K))
+     */
+    std::vector<std::pair<K, V>> Sorted() const {
+        std::vector<std::pair<K, V>> sorted{heap};
+        std::sort(sorted.begin(), sorted.end(), Higher);
+        return sorted;
+    }
+
+    std::vector<K> Keys() const {
+        std::vector<K> keys;
+        keys.reserve(heap.size());
+        for (const auto &pair : heap) keys.push_back(pair.first);
+        return keys;
+    }
+
+    bool Empty() const { return heap.empty(); }
+
+    bool Full() const { return heap.size() == capacity; }
+
+    size_t Size() const { return heap.size(); }
+
+    size_t Capacity() const { return capacity; }
+
+    /**
+     * Whether the resident pairs are guaranteed to be the top K of every key seen
+     * with its latest value; always true for streams where values only improve
+     */
+    bool Exact() const { return exact; }
+
+    void Clear() {
+        heap.clear();
+        index.clear();
+        best_forgotten.clear();
+        exact = true;
+    }
+
+private:
+    static bool Higher(const std::pair<K, V> &a, const std::pair<K, V> &b) {
+        Compare less;
+        return less(b.second, a.second) || (!less(a.second, b.second) && b.first < a.first);
+    }
+
+    void Forget(std::pair<K, V> pair) {
+        if (best_forgotten.empty()) {
+            best_forgotten.push_back(std::move(pair));
+        } else if (Higher(pair, best_forgotten.front())) {
+            best_forgotten.front() = std::move(pair);
+        }
+    }
+
+    void Swap(size_t a, size_t b) {
+        std::swap(heap[a], heap[b]);
+        index[heap[a].first] = a;
+        index[heap[b].first] = b;
+    }
+
+    /**
+     * move a pair that got worse towards the root
+     */
+    void SiftUp(size_t pos) {
+        while (pos > 0) {
+            const auto parent = (pos - 1) / 2;
+            if (!Higher(heap[parent], heap[pos])) break;
+            Swap(parent, pos);
+            pos = parent;
+        }
+    }
+
+    /**
+     * move a pair that got better towards the leafs
+     */
+    void SiftDown(size_t pos) {
+        while (true) {
+            auto worst = pos;
+            for (auto child = 2 * pos + 1; child <= 2 * pos + 2 && child < heap.size(); ++child)
+                if (Higher(heap[worst], heap[child])) worst = child;
+            if (worst == pos) break;
+            Swap(pos, worst);
+            pos = worst;
+        }
+    }
+
+    const size_t capacity;
+    // min-heap: the worst resident pair at the root
+    std::vector<std::pair<K, V>> heap;
+    // key -> position in heap
+    std::unordered_map<K, size_t> index;
+    // best pair dropped so far, if any; a vector of at most one so K and V need no default constructor
+    std::vector<std::pair<K, V>> best_forgotten;
+    bool exact;
+};
+
+}
+
+#endif //HARA_TOPK_H
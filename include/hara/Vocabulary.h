@@ -0,0 +1,104 @@
+#ifndef HARA_VOCABULARY_H
+#define HARA_VOCABULARY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PrefixTree.h"
+#include "StringView.h"
+#include "Macros.h"
+
+namespace hara {
+
+/**
+ * Interns tokens into dense uint32 ids
+ *
+ * Ids index a single contiguous string pool, so id -> token is O(1) without allocation;
+ * token -> id and longest matches go through a PrefixTree holding the ids
+ * Id 0 is reserved for <unk> and is not matchable
+ */
+class Vocabulary {
+public:
+    static constexpr uint32_t UNKNOWN = 0;
+
+    Vocabulary() : offsets{0} {
+        Append("<unk>");
+    }
+
+    /**
+     * @return the id of token, newly assigned unless already present
+     */
+    uint32_t Insert(const std::string &token) {
+        ASSERT(!token.empty(), "Cannot insert an empty token");
+        uint32_t id;
+        if (Find(token, id)) return id;
+        id = static_cast<uint32_t>(Size());
+        tree.Insert(std::vector<char>{token.begin(), token.end()}, id);
+        Append(token);
+        return id;
+    }
+
+    /**
+     * @return UNKNOWN if token is not in the vocabulary
+     */
+    uint32_t Id(const std::string &token) const {
+        uint32_t id;
+        if (!Find(token, id)) id = UNKNOWN;
+        return id;
+    }
+
+    /**
+     * View into the string pool; invalidated by the next Insert
+     * Complexity: O(1)
+     */
+    StringView Token(uint32_t id) const {
+        ASSERT(id < Size(), "Unknown id");
+        return {pool.data() + offsets[id], offsets[id + 1] - offsets[id]};
+    }
+
+    /**
+     * Longest prefix of [begin, end) that is a vocabulary token
+     * @param id set to its id, or UNKNOWN if there is none
+     * @return its length; 0 if there is none
+     */
+    template<typename Iterator>
+    size_t LongestMatch(Iterator begin, Iterator end, uint32_t &id) const {
+        const uint32_t *value;
+        const auto length = tree.LongestMatch(begin, end, value);
+        if (value) id = *value;
+        else id = UNKNOWN;
+        return length;
+    }
+
+    /**
+     * Longest prefix of [begin, end) that starts some vocabulary token
+     */
+    template<typename Iterator>
+    size_t LongestPrefix(Iterator begin, Iterator end) const {
+        return tree.LongestPrefix(begin, end);
+    }
+
+    /**
+     * number of ids, including UNKNOWN
+     */
+    size_t Size() const { return offsets.size() - 1; }
+
+private:
+    bool Find(const std::string &token, uint32_t &id) const {
+        return LongestMatch(token.begin(), token.end(), id) == token.size() && id != UNKNOWN;
+    }
+
+    void Append(const std::string &token) {
+        pool.append(token);
+        offsets.push_back(pool.size());
+    }
+
+    PrefixTree<char, uint32_t> tree;
+    // every token back to back, token i at [offsets[i], offsets[i + 1])
+    std::string pool;
+    std::vector<size_t> offsets;
+};
+
+}
+
+#endif //HARA_VOCABULARY_H
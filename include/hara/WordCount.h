@@ -0,0 +1,127 @@
+#ifndef HARA_WORD_COUNT_H
+#define HARA_WORD_COUNT_H
+
+#include <cctype>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Arena.h"
+#include "BoundedQueue.h"
+#include "FrequencyTable.h"
+#include "Input.h"
+#include "StringView.h"
+
+namespace hara {
+
+/**
+ * Token frequencies over Input streams
+ *
+ * The calling thread reads batches of lines into per-batch arenas, without an allocation per line,
+ * and hands them to num_threads workers;
+ * each worker splits lines on whitespace into views and counts them in its own FrequencyTable,
+ * and the tables are merged once the input is exhausted
+ */
+class WordCount {
+public:
+    explicit WordCount(size_t num_threads = 1, size_t batch_size = 4096)
+            : num_threads{num_threads}, batch_size{std::max<size_t>(1, batch_size)} {}
+
+    /**
+     * Count every token of the input on top of what was counted so far
+     * Lines are read by view (GetLine(StringView &)), so the input must not be read otherwise after the call
+     * An exception thrown while reading or counting stops the workers and is rethrown here
+     */
+    void Add(Input &input) {
+        if (num_threads <= 1) {
+            StringView line;
+            while (input.GetLine(line)) CountLine(line, table);
+            return;
+        }
+
+        // lines of a batch are copied into its arena, which is rewound when the batch is reused
+        const size_t num_batches = 2 * num_threads + 1;
+        std::vector<Batch> batches(num_batches);
+        BoundedQueue<Batch *> free{num_batches}, work{num_batches};
+        for (auto &batch : batches) {
+            batch.lines.reserve(batch_size);
+            free.Push(&batch);
+        }
+
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto fail = [&]() {
+            {
+                std::lock_guard<std::mutex> lock{error_mutex};
+                if (!error) error = std::current_exception();
+            }
+            free.Close();
+            work.Close();
+        };
+
+        std::vector<FrequencyTable> tables(num_threads);
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            workers.emplace_back([&, t]() {
+                try {
+                    Batch *batch;
+                    while (work.Pop(batch)) {
+                        for (const auto &line : batch->lines) CountLine(line, tables[t]);
+                        if (!free.Push(batch)) break;
+                    }
+                } catch (...) {
+                    fail();
+                }
+            });
+        }
+
+        try {
+            Batch *batch;
+            StringView line;
+            while (free.Pop(batch)) {
+                batch->arena.Reset();
+                batch->lines.clear();
+                while (batch->lines.size() < batch_size && input.GetLine(line))
+                    batch->lines.push_back(batch->arena.Store(line));
+                const bool last = batch->lines.size() < batch_size;
+                if (!batch->lines.empty() && !work.Push(batch)) break;
+                if (last) break;
+            }
+        } catch (...) {
+            fail();
+        }
+        work.Close();
+        for (auto &worker : workers) worker.join();
+        if (error) std::rethrow_exception(error);
+
+        for (const auto &thread_table : tables) table.Merge(thread_table);
+    }
+
+    const FrequencyTable &Table() const { return table; }
+
+private:
+    struct Batch {
+        Arena arena;
+        std::vector<StringView> lines;
+    };
+
+    static void CountLine(StringView line, FrequencyTable &counts) {
+        const auto end = line.data() + line.size();
+        auto it = line.data();
+        while (it != end) {
+            while (it != end && std::isspace(static_cast<unsigned char>(*it))) ++it;
+            auto token = it;
+            while (it != end && !std::isspace(static_cast<unsigned char>(*it))) ++it;
+            if (token != it) counts.Add({token, static_cast<size_t>(it - token)});
+        }
+    }
+
+    const size_t num_threads;
+    const size_t batch_size;
+    FrequencyTable table;
+};
+
+}
+
+#endif //HARA_WORD_COUNT_H
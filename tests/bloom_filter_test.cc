@@ -0,0 +1,48 @@
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include "hara/BloomFilter.h"
+#include "hara/Macros.h"
+
+/**
+ * Measured false positive rate against FalsePositiveRate(), for up to and beyond 7 hashes
+ * where the bit positions come from more than one remix of the fingerprint
+ */
+void TestFalsePositiveRate(size_t num_hashes, size_t bits_per_element) {
+    const size_t num_elements = 200000, num_probes = 1000000;
+    hara::BloomFilter filter{num_elements * bits_per_element / 8, num_hashes};
+    std::mt19937_64 gen{num_hashes};
+    for (size_t i = 0; i < num_elements; ++i) filter.Insert(gen());
+
+    // fresh random fingerprints are all absent, up to a negligible chance of collision
+    size_t false_positives = 0;
+    for (size_t i = 0; i < num_probes; ++i) false_positives += filter.Contain(gen());
+    const auto measured = static_cast<double>(false_positives) / num_probes;
+    const auto estimated = filter.FalsePositiveRate();
+    const auto message = std::to_string(num_hashes) + " hashes: measured " + std::to_string(measured) +
+                         ", estimated " + std::to_string(estimated);
+    std::cout << message << std::endl;
+    ASSERT(std::fabs(measured - estimated) <= 0.15 * estimated + 1e-4, message);
+}
+
+/**
+ * Inserted fingerprints are always found
+ */
+void TestNoFalseNegatives(size_t num_hashes) {
+    hara::BloomFilter filter{1 << 16, num_hashes};
+    std::mt19937_64 gen{42};
+    for (size_t i = 0; i < 50000; ++i) filter.Insert(gen());
+    gen.seed(42);
+    for (size_t i = 0; i < 50000; ++i) ASSERT(filter.Contain(gen()), "False negative");
+}
+
+int main() {
+    for (size_t num_hashes : {3, 7, 8, 10, 14, 16}) {
+        TestFalsePositiveRate(num_hashes, 16);
+        TestNoFalseNegatives(num_hashes);
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
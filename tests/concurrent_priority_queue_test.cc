@@ -0,0 +1,133 @@
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "hara/ConcurrentPriorityQueue.h"
+#include "hara/Macros.h"
+
+using Queue = hara::ConcurrentPriorityQueue2<int, int>;
+
+/**
+ * A single element among many empty shards is still found by a relaxed pop
+ */
+void TestRelaxedSingleShard() {
+    Queue queue{Queue::Ordering::Relaxed, 16, 4};
+    for (int round = 0; round < 1000; ++round) {
+        queue.InsertOrUpdate({round, round});
+        std::pair<int, int> top;
+        ASSERT(queue.Pop(top) && top.first == round, "Relaxed pop missed the only element");
+        ASSERT(!queue.Pop(top), "Relaxed pop on an empty queue");
+    }
+}
+
+/**
+ * Concurrent relaxed pops hand out every element exactly once
+ */
+void TestRelaxedConcurrent() {
+    const int num_threads = 4, per_thread = 20000;
+    Queue queue{Queue::Ordering::Relaxed, num_threads};
+    std::vector<std::vector<int>> popped(num_threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&queue, &popped, t]() {
+            for (int i = 0; i < per_thread; ++i) {
+                queue.InsertOrUpdate({t * per_thread + i, i});
+                std::pair<int, int> top;
+                if (i % 2 && queue.Pop(top)) popped[t].push_back(top.first);
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    std::pair<int, int> top;
+    std::vector<int> seen(num_threads * per_thread, 0);
+    while (queue.Pop(top)) ++seen[top.first];
+    for (const auto &keys : popped)
+        for (const auto key : keys) ++seen[key];
+    for (const auto count : seen) ASSERT(count == 1, "Element popped " + std::to_string(count) + " times");
+}
+
+/**
+ * Strict pops come out in order
+ */
+void TestStrictOrder() {
+    Queue queue{Queue::Ordering::Strict, 4};
+    for (int i = 0; i < 1000; ++i) queue.InsertOrUpdate({i, (i * 7919) % 1000});
+    std::pair<int, int> top;
+    int last = 1000;
+    while (queue.Pop(top)) {
+        ASSERT(top.second <= last, "Strict pop out of order");
+        last = top.second;
+    }
+}
+
+/**
+ * Concurrent strict pops hand out every element once, and without concurrent updates
+ * every thread sees them in order
+ */
+void TestStrictConcurrent() {
+    const int num_threads = 4, num_keys = 40000;
+    Queue queue{Queue::Ordering::Strict, num_threads};
+    for (int key = 0; key < num_keys; ++key) queue.InsertOrUpdate({key, (key * 7919) % num_keys});
+    std::vector<std::vector<int>> popped(num_threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&queue, &popped, t]() {
+            std::pair<int, int> top;
+            while (queue.Pop(top)) {
+                ASSERT(popped[t].empty() || top.second < popped[t].back(), "Strict pop out of order across threads");
+                popped[t].push_back(top.second);
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    std::vector<int> seen(num_keys, 0);
+    for (const auto &values : popped)
+        for (const auto value : values) ++seen[value];
+    for (const auto count : seen) ASSERT(count == 1, "Element popped " + std::to_string(count) + " times");
+}
+
+/**
+ * Updates racing with strict pops neither lose nor duplicate elements;
+ * an update may come after another thread popped the key, inserting it again
+ */
+void TestStrictWithUpdates() {
+    const int num_threads = 4, per_thread = 20000;
+    Queue queue{Queue::Ordering::Strict, num_threads};
+    std::vector<std::vector<int>> popped(num_threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&queue, &popped, t]() {
+            for (int i = 0; i < per_thread; ++i) {
+                queue.InsertOrUpdate({t * per_thread + i, i % 97});
+                if (i % 3 == 0) queue.InsertOrUpdate({t * per_thread + i, i % 89});
+                std::pair<int, int> top;
+                if (i % 2 && queue.Pop(top)) popped[t].push_back(top.first);
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    std::pair<int, int> top;
+    std::vector<int> seen(num_threads * per_thread, 0);
+    int last = 1000;
+    while (queue.Pop(top)) {
+        ASSERT(top.second <= last, "Strict pop out of order");
+        last = top.second;
+        ++seen[top.first];
+    }
+    for (const auto &keys : popped)
+        for (const auto key : keys) ++seen[key];
+    for (int key = 0; key < num_threads * per_thread; ++key) {
+        const int inserts = key % per_thread % 3 == 0 ? 2 : 1;
+        ASSERT(seen[key] >= 1 && seen[key] <= inserts, "Element popped " + std::to_string(seen[key]) + " times");
+    }
+}
+
+int main() {
+    TestRelaxedSingleShard();
+    TestRelaxedConcurrent();
+    TestStrictOrder();
+    TestStrictConcurrent();
+    TestStrictWithUpdates();
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include "hara/ExternalSort.h"
+#include "hara/Input.h"
+#include "hara/Output.h"
+#include "hara/Macros.h"
+
+const std::string dir = "/tmp/hara_external_sort_test_" + std::to_string(getpid());
+
+std::string ReadFile(const std::string &path) {
+    std::ifstream ifs{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{}};
+}
+
+void WriteFile(const std::string &path, const std::string &content) {
+    std::ofstream ofs{path, std::ios::binary};
+    ofs.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+/**
+ * Files left in the run directory
+ */
+size_t NumFiles(const std::string &path) {
+    auto dp = opendir(path.c_str());
+    ASSERT(dp != nullptr, "Cannot open " + path);
+    size_t num_files = 0;
+    while (auto entry = readdir(dp)) {
+        const std::string name = entry->d_name;
+        if (name != "." && name != "..") ++num_files;
+    }
+    closedir(dp);
+    return num_files;
+}
+
+std::vector<std::string> RandomLines(size_t num_lines, size_t vocabulary) {
+    std::mt19937 gen{7};
+    std::uniform_int_distribution<size_t> word{0, vocabulary - 1};
+    std::vector<std::string> lines;
+    for (size_t idx = 0; idx < num_lines; ++idx) lines.push_back("line " + std::to_string(word(gen)));
+    // tabs must survive the count prefix of runs
+    lines.push_back("with\ttab");
+    lines.push_back("with\ttab");
+    lines.push_back("");
+    return lines;
+}
+
+std::string Sort(const std::string &input_path, hara::ExternalSort::Options options, size_t &num_runs) {
+    const auto output_path = dir + "/sorted.txt";
+    options.tmpdir = dir + "/runs";
+    {
+        hara::Input input{input_path};
+        hara::Output output{output_path};
+        hara::ExternalSort sort{options};
+        sort.Run(input, output);
+        output.Close();
+        num_runs = sort.NumRuns();
+    }
+    ASSERT(NumFiles(options.tmpdir) == 0, "Run files left behind");
+    auto sorted = ReadFile(output_path);
+    std::remove(output_path.c_str());
+    return sorted;
+}
+
+void TestModes() {
+    const auto lines = RandomLines(20000, 3000);
+    const auto input_path = dir + "/input.txt";
+    std::string content;
+    for (const auto &line : lines) content.append(line).push_back('\n');
+    WriteFile(input_path, content);
+
+    auto sorted_lines = lines;
+    std::sort(sorted_lines.begin(), sorted_lines.end());
+    std::string expected, expected_unique, expected_count;
+    for (const auto &line : sorted_lines) expected.append(line).push_back('\n');
+    std::map<std::string, size_t> counts;
+    for (const auto &line : lines) ++counts[line];
+    for (const auto &entry : counts) {
+        expected_unique.append(entry.first).push_back('\n');
+        expected_count.append(std::to_string(entry.second)).append("\t").append(entry.first).push_back('\n');
+    }
+
+    for (size_t num_threads : {1, 3}) {
+        for (size_t memory_limit : {size_t{1} << 30u, size_t{4096}}) {
+            hara::ExternalSort::Options options;
+            options.num_threads = num_threads;
+            options.memory_limit = memory_limit;
+            options.max_fan_in = 3;
+            const bool in_memory = memory_limit > content.size() * 4;
+
+            size_t num_runs;
+            ASSERT(Sort(input_path, options, num_runs) == expected, "Wrong sort");
+            if (in_memory) {
+                ASSERT(num_runs == 0, "Spilled although the input fits in memory");
+            } else {
+                // a hundred runs or more take several passes at a fan-in of 3
+                ASSERT(num_runs > 100, "Expected multiple merge passes");
+            }
+
+            options.unique = true;
+            ASSERT(Sort(input_path, options, num_runs) == expected_unique, "Wrong unique sort");
+
+            options.unique = false;
+            options.count = true;
+            ASSERT(Sort(input_path, options, num_runs) == expected_count, "Wrong counting sort");
+        }
+    }
+    std::remove(input_path.c_str());
+}
+
+void TestRunsRemovedOnError() {
+#ifdef HARA_ZLIB
+    // a gzip stream cut short, beyond the first decoded blocks, fails only after several runs were spilled
+    const auto lines = RandomLines(200000, 200000);
+    const auto input_path = dir + "/input.txt.gz";
+    {
+        hara::Output output{input_path};
+        for (const auto &line : lines) output << line << '\n';
+        output.Close();
+    }
+    auto compressed = ReadFile(input_path);
+    WriteFile(input_path, compressed.substr(0, compressed.size() * 3 / 4));
+
+    hara::ExternalSort::Options options;
+    options.memory_limit = 1u << 16u;
+    options.tmpdir = dir + "/runs";
+    hara::ExternalSort sort{options};
+    bool thrown = false;
+    try {
+        hara::Input input{input_path};
+        hara::Output output{dir + "/sorted.txt"};
+        sort.Run(input, output);
+    } catch (const std::exception &) {
+        thrown = true;
+    }
+    ASSERT(thrown, "Truncated input was accepted");
+    ASSERT(sort.NumRuns() > 1, "Expected runs spilled before the error");
+    ASSERT(NumFiles(options.tmpdir) == 0, "Run files leaked by a failed sort");
+    std::remove((dir + "/sorted.txt").c_str());
+    std::remove(input_path.c_str());
+#endif
+}
+
+void TestMissingTmpdir() {
+    hara::ExternalSort::Options options;
+    options.memory_limit = 1;
+    options.tmpdir = dir + "/missing";
+    const auto input_path = dir + "/input.txt";
+    WriteFile(input_path, "b\na\n");
+    hara::ExternalSort sort{options};
+    bool thrown = false;
+    try {
+        hara::Input input{input_path};
+        hara::Output output{dir + "/sorted.txt"};
+        sort.Run(input, output);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    ASSERT(thrown, "Expected an error for a missing tmpdir");
+    std::remove((dir + "/sorted.txt").c_str());
+    std::remove(input_path.c_str());
+}
+
+int main() {
+    ASSERT(system(("mkdir -p " + dir + "/runs").c_str()) == 0, "Cannot create " + dir);
+    TestModes();
+    TestRunsRemovedOnError();
+    TestMissingTmpdir();
+    ASSERT(system(("rm -rf " + dir).c_str()) == 0, "Cannot remove " + dir);
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hara/Input.h"
+#include "hara/Output.h"
+#include "hara/Macros.h"
+
+std::string ReadFile(const std::string &path) {
+    std::ifstream ifs{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{}};
+}
+
+void WriteFile(const std::string &path, const std::string &content) {
+    std::ofstream ofs{path, std::ios::binary};
+    ofs.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+/**
+ * Every line of the input, read by string or by view
+ */
+std::string ReadLines(const std::string &path, bool by_view) {
+    hara::Input input{path};
+    std::string content;
+    if (by_view) {
+        hara::StringView line;
+        while (input.GetLine(line)) content.append(line.data(), line.size()).push_back('\n');
+    } else {
+        std::string line;
+        while (input.GetLine(line)) content.append(line).push_back('\n');
+    }
+    return content;
+}
+
+bool ReadFails(const std::string &path, bool by_view) {
+    try {
+        ReadLines(path, by_view);
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Through a named pipe, which cannot seek back over the bytes read to detect the codec
+ * Constructing the Input must not wait for data: the writer only starts once it returned
+ */
+std::string ReadThroughPipe(const std::string &fifo, const std::string &content, bool by_view) {
+    std::atomic<bool> constructed{false};
+    std::thread writer{[&]() {
+        std::ofstream ofs{fifo, std::ios::binary};
+        while (!constructed) std::this_thread::yield();
+        ofs.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }};
+    std::string read;
+    {
+        hara::Input input{fifo};
+        constructed = true;
+        if (by_view) {
+            hara::StringView line;
+            while (input.GetLine(line)) read.append(line.data(), line.size()).push_back('\n');
+        } else {
+            std::string line;
+            while (input.GetLine(line)) read.append(line).push_back('\n');
+        }
+    }
+    writer.join();
+    return read;
+}
+
+/**
+ * Plain inputs that start like a compressed stream are read as they are
+ */
+void TestPlainLookalikes(const std::string &tmp) {
+    const auto path = tmp + ".txt", fifo = tmp + ".fifo";
+    ASSERT(mkfifo(fifo.c_str(), 0600) == 0, "Cannot create " + fifo);
+    const std::vector<std::string> contents{"plain\nlines\n", "(\n", "(\xb5\x2f\n(a\n", "(\xb5\x2f\xfe\n",
+                                           "\x1f\n", "\x1f\x1f\x8b\n"};
+    for (const auto &content : contents) {
+        for (bool by_view : {false, true}) {
+            WriteFile(path, content);
+            ASSERT(ReadLines(path, by_view) == content, "Plain file read wrong");
+            ASSERT(ReadThroughPipe(fifo, content, by_view) == content, "Plain pipe read wrong");
+        }
+    }
+    std::remove(fifo.c_str());
+    std::remove(path.c_str());
+}
+
+#ifdef HARA_ZLIB
+
+/**
+ * Concatenated members, as written by pigz or bgzip, read as one stream, from a file or a pipe
+ */
+void TestGzipMembers(const std::string &tmp) {
+    const auto a = tmp + "_a.gz", b = tmp + "_b.gz", both = tmp + "_both.gz", fifo = tmp + ".fifo";
+    std::string expected;
+    {
+        hara::Output output_a{a}, output_b{b};
+        for (size_t idx = 0; idx < 100000; ++idx) {
+            const auto line = std::to_string(idx * 7919) + " line\n";
+            (idx < 60000 ? output_a : output_b) << line;
+            expected += line;
+        }
+        output_a.Close();
+        output_b.Close();
+    }
+    const auto compressed = ReadFile(a) + ReadFile(b);
+    WriteFile(both, compressed);
+    ASSERT(mkfifo(fifo.c_str(), 0600) == 0, "Cannot create " + fifo);
+    for (bool by_view : {false, true}) {
+        ASSERT(ReadLines(both, by_view) == expected, "Multi-member gzip read wrong");
+        ASSERT(ReadThroughPipe(fifo, compressed, by_view) == expected, "Multi-member gzip pipe read wrong");
+    }
+    std::remove(fifo.c_str());
+
+    // truncated within the second member, or within the first
+    for (const auto size : {compressed.size() - 4, compressed.size() / 2, size_t{12}}) {
+        WriteFile(both, compressed.substr(0, size));
+        for (bool by_view : {false, true})
+            ASSERT(ReadFails(both, by_view), "Truncated gzip at " + std::to_string(size) + " read silently");
+    }
+
+    // garbage after the last member, and a corrupted member
+    WriteFile(both, compressed + "garbage\n");
+    for (bool by_view : {false, true}) ASSERT(ReadFails(both, by_view), "Trailing garbage read silently");
+    auto corrupted = compressed;
+    for (size_t idx = 100; idx < 200; ++idx) corrupted[idx] = static_cast<char>(~corrupted[idx]);
+    WriteFile(both, corrupted);
+    for (bool by_view : {false, true}) ASSERT(ReadFails(both, by_view), "Corrupted gzip read silently");
+
+    std::remove(a.c_str());
+    std::remove(b.c_str());
+    std::remove(both.c_str());
+}
+
+#endif
+
+int main() {
+    const std::string tmp = "/tmp/hara_input_test_" + std::to_string(getpid());
+    TestPlainLookalikes(tmp);
+#ifdef HARA_ZLIB
+    TestGzipMembers(tmp);
+#endif
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <clocale>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "hara/Number.h"
+#include "hara/Macros.h"
+
+using hara::Number;
+
+template<typename T>
+Number::Error Parse(const std::string &text, T &value, size_t &used) {
+    const auto result = Number::Parse(text.data(), text.data() + text.size(), value);
+    used = static_cast<size_t>(result.ptr - text.data());
+    return result.error;
+}
+
+template<typename T>
+void ExpectValue(const std::string &text, T expected, size_t expected_used) {
+    T value{};
+    size_t used;
+    ASSERT(Parse(text, value, used) == Number::Error::None, "'" + text + "' did not parse");
+    ASSERT(value == expected && used == expected_used, "'" + text + "' parsed wrong");
+}
+
+template<typename T>
+void ExpectError(const std::string &text, Number::Error expected, size_t expected_used) {
+    T value{7};
+    size_t used;
+    ASSERT(Parse(text, value, used) == expected && used == expected_used, "'" + text + "' gave the wrong error");
+    ASSERT(value == T{7}, "'" + text + "' changed the value on error");
+}
+
+void TestIntegers() {
+    ExpectValue<int>("123", 123, 3);
+    ExpectValue<int>("+5x", 5, 2);
+    ExpectValue<int>("-2147483648", std::numeric_limits<int>::min(), 11);
+    ExpectValue<int64_t>("-9223372036854775808", std::numeric_limits<int64_t>::min(), 20);
+    ExpectValue<uint64_t>("18446744073709551615", std::numeric_limits<uint64_t>::max(), 20);
+    ExpectValue<unsigned>("-0", 0u, 2);
+
+    ExpectError<int>("", Number::Error::Invalid, 0);
+    ExpectError<int>("-", Number::Error::Invalid, 0);
+    ExpectError<int>("x1", Number::Error::Invalid, 0);
+    ExpectError<int>("2147483648", Number::Error::OutOfRange, 10);
+    ExpectError<uint64_t>("18446744073709551616", Number::Error::OutOfRange, 20);
+    ExpectError<int64_t>("99999999999999999999999", Number::Error::OutOfRange, 23);
+    ExpectError<uint8_t>("256", Number::Error::OutOfRange, 3);
+
+    // a sign an unsigned type cannot hold is a format error, not a wrapped or out-of-range value
+    ExpectError<unsigned>("-5", Number::Error::Invalid, 0);
+    ExpectError<uint64_t>("-1", Number::Error::Invalid, 0);
+    ExpectError<uint64_t>("-99999999999999999999999", Number::Error::Invalid, 0);
+}
+
+void TestFloats() {
+    ExpectValue<double>("1.5e3", 1500., 5);
+    ExpectValue<double>(".5", .5, 2);
+    ExpectValue<double>("1e", 1., 1);
+    ExpectValue<double>("-inf", -std::numeric_limits<double>::infinity(), 4);
+    ExpectValue<double>("1e-999", 0., 6);
+    ExpectError<double>(".", Number::Error::Invalid, 0);
+    ExpectError<double>("1e999", Number::Error::OutOfRange, 5);
+}
+
+/**
+ * Format writes the shortest text that parses back to the same value
+ */
+void TestRoundTrip() {
+    std::mt19937_64 gen{3};
+    char text[Number::MAX_LENGTH];
+    for (size_t i = 0; i < 200000; ++i) {
+        double value;
+        const auto bits = gen();
+        std::memcpy(&value, &bits, sizeof(value));
+        if (value != value) continue;
+        const auto end = Number::Format(text, value);
+        double parsed;
+        const auto result = Number::Parse(text, end, parsed);
+        ASSERT(result.error == Number::Error::None && result.ptr == end && parsed == value,
+               "Round trip failed for " + std::string(text, end));
+
+        const auto int_value = static_cast<int64_t>(bits);
+        const auto int_end = Number::Format(text, int_value);
+        ASSERT(std::string(text, int_end) == std::to_string(int_value), "Integer formatting differs");
+    }
+    const auto end = Number::Format(text, 0.1);
+    ASSERT(std::string(text, end) == "0.1", "0.1 not formatted shortest");
+}
+
+/**
+ * The strtod / snprintf fallbacks ignore a comma-decimal LC_NUMERIC
+ * Skipped unless such a locale is installed; HARA_COMMA_LOCALE names one explicitly
+ */
+void TestCommaLocale() {
+    std::vector<std::string> names{"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "de_DE", "fr_FR"};
+    if (std::getenv("HARA_COMMA_LOCALE")) names.insert(names.begin(), std::getenv("HARA_COMMA_LOCALE"));
+    const char *name = nullptr;
+    for (const auto &candidate : names) {
+        if (std::setlocale(LC_NUMERIC, candidate.c_str())) {
+            name = candidate.c_str();
+            break;
+        }
+    }
+    if (!name) {
+        std::cerr << "No comma-decimal locale installed; skipping the locale test" << std::endl;
+        return;
+    }
+    char text[Number::MAX_LENGTH];
+    for (const double value : {0.1 + 0.2, 1e300, 1.2345678901234567e-200, 2.5e-5, 123456789012345678.}) {
+        const auto end = Number::Format(text, value);
+        ASSERT(std::find(text, end, ',') == end, "Formatted with a comma under " + std::string{name});
+        double parsed;
+        const auto result = Number::Parse(text, end, parsed);
+        ASSERT(result.ptr == end && parsed == value, "Round trip failed under " + std::string{name});
+    }
+    // more than 19 significant digits take the strtod fallback
+    ExpectValue<double>("1.00000000000000000000001e-5", 1e-5, 28);
+    std::setlocale(LC_NUMERIC, "C");
+}
+
+int main() {
+    TestIntegers();
+    TestFloats();
+    TestRoundTrip();
+    TestCommaLocale();
+    std::cout << "OK" << std::endl;
+    return 0;
+}
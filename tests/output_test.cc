@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "hara/Input.h"
+#include "hara/Output.h"
+#include "hara/Macros.h"
+
+/**
+ * Close reports a full disk instead of leaving a truncated file behind silently
+ */
+void TestCloseReportsErrors(const std::string &path) {
+    bool failed = false;
+    try {
+        hara::Output output{path};
+        output << "line\n";
+        output.Close();
+    } catch (const std::runtime_error &) {
+        failed = true;
+    }
+    ASSERT(failed, "Close on a full device did not throw for " + path);
+}
+
+/**
+ * Everything written before Close reads back, writes after it are dropped
+ */
+void TestCloseRoundTrip(const std::string &path) {
+    {
+        hara::Output output{path};
+        output << "first" << '\n' << 42 << '\n';
+        ASSERT(output, "Output failed before Close");
+        output.Close();
+        output << "dropped\n";
+        ASSERT(!output, "String written after Close");
+        // numbers take a path of their own straight into the buffer
+        for (int i = 0; i < 100000; ++i) output << i << 1.5;
+        ASSERT(!output, "Numbers written after Close");
+    }
+    hara::Input input{path};
+    std::string first, second, third;
+    ASSERT(input.GetLine(first) && first == "first", "Lost the first line of " + path);
+    ASSERT(input.GetLine(second) && second == "42", "Lost the second line of " + path);
+    ASSERT(!input.GetLine(third), "Wrote after Close to " + path);
+    std::remove(path.c_str());
+}
+
+int main() {
+    const std::string tmp = "/tmp/hara_output_test_" + std::to_string(getpid());
+    TestCloseRoundTrip(tmp + ".txt");
+    TestCloseReportsErrors("/dev/full");
+#ifdef HARA_ZLIB
+    TestCloseRoundTrip(tmp + ".txt.gz");
+    // a compressed path onto the full device
+    const auto full = tmp + "_full.gz";
+    ASSERT(symlink("/dev/full", full.c_str()) == 0, "Cannot link " + full);
+    TestCloseReportsErrors(full);
+    std::remove(full.c_str());
+#endif
+#ifdef HARA_ZSTD
+    TestCloseRoundTrip(tmp + ".txt.zst");
+#endif
+    std::cout << "OK" << std::endl;
+    return 0;
+}
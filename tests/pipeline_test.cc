@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "hara/Pipeline.h"
+#include "hara/Macros.h"
+
+/**
+ * Results come out in input order whatever the number of workers and the batch size
+ */
+void TestOrder(const std::string &path, size_t num_threads, size_t batch_size) {
+    const auto out_path = path + ".out";
+    {
+        hara::Input input{path};
+        hara::Output output{out_path};
+        hara::Pipeline{num_threads, batch_size}.Run(input, output, [](const std::string &line, std::string &result) {
+            result = "<" + line + ">\n";
+        });
+        output.Close();
+    }
+    hara::Input input{out_path};
+    std::string line;
+    size_t idx = 0;
+    for (; input.GetLine(line); ++idx)
+        ASSERT(line == "<" + (idx % 10 == 0 ? std::string{} : std::to_string(idx)) + ">",
+               "Line " + std::to_string(idx) + " out of order");
+    ASSERT(idx == 10000, "Lost lines with " + std::to_string(num_threads) + " threads");
+    std::remove(out_path.c_str());
+}
+
+/**
+ * An exception thrown by the transform reaches the caller
+ */
+void TestTransformError(const std::string &path, size_t num_threads) {
+    bool failed = false;
+    try {
+        hara::Input input{path};
+        hara::Output output{"/dev/null"};
+        hara::Pipeline{num_threads, 7}.Run(input, output, [](const std::string &line, std::string &result) {
+            if (line == "5001") throw std::runtime_error("transform failed");
+            result = line;
+        });
+    } catch (const std::runtime_error &) {
+        failed = true;
+    }
+    ASSERT(failed, "Transform error lost with " + std::to_string(num_threads) + " threads");
+}
+
+int main() {
+    const std::string path = "/tmp/hara_pipeline_test_" + std::to_string(getpid()) + ".txt";
+    {
+        hara::Output output{path};
+        // every tenth line empty
+        for (size_t idx = 0; idx < 10000; ++idx) output << (idx % 10 == 0 ? std::string{} : std::to_string(idx)) << '\n';
+        output.Close();
+    }
+    for (size_t num_threads : {1, 2, 4})
+        for (size_t batch_size : {1, 7, 4096}) TestOrder(path, num_threads, batch_size);
+    for (size_t num_threads : {1, 4}) TestTransformError(path, num_threads);
+    std::remove(path.c_str());
+    std::cout << "OK" << std::endl;
+    return 0;
+}
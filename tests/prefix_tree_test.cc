@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "hara/PrefixTree.h"
+#include "hara/Macros.h"
+
+using Tree = hara::PrefixTree<char, size_t>;
+
+std::vector<char> Chars(const std::string &s) { return {s.begin(), s.end()}; }
+
+/**
+ * A key of a million chars makes a chain of a million nodes, which Clear and the destructor
+ * free without recursing; build with HARA_TESTS_SANITIZE to have leaks reported
+ */
+void TestDeepChain() {
+    const std::vector<char> deep(1000000, 'a');
+    Tree tree;
+    for (int round = 0; round < 2; ++round) {
+        ASSERT(tree.Insert(deep, 1), "Deep key not inserted");
+        ASSERT(tree.Insert(Chars("ab"), 2), "Short key not inserted");
+        auto leafs = tree.FindAll(Chars("aaa"));
+        ASSERT(leafs.size() == 1 && leafs.front().Data() == 1, "Deep key not found");
+        ASSERT(tree.MemoryUsage().nodes > deep.size() * sizeof(size_t), "Deep chain not accounted for");
+        tree.Clear();
+        ASSERT(tree.Empty() && tree.FindAll().empty(), "Clear left leafs behind");
+        ASSERT(tree.MemoryUsage().Total() == sizeof(hara::PrefixNode<char, size_t>), "Clear left nodes behind");
+    }
+    // freed by the destructor this time
+    tree.Insert(deep, 3);
+}
+
+/**
+ * A moved tree keeps its leafs, the moved-from tree is empty and usable
+ */
+void TestMove() {
+    Tree a;
+    for (const auto &key : {"", "a", "ab", "abc", "b"}) a.Insert(Chars(key), std::string{key}.size());
+    auto leafs = a.FindAll(Chars("ab"));
+    ASSERT(leafs.size() == 2, "Wrong leafs under ab");
+
+    Tree b{std::move(a)};
+    ASSERT(a.Empty() && a.FindAll().empty(), "Moved-from tree not empty");
+    ASSERT(b.Size() == 5 && b.FindAll().size() == 5, "Moved tree lost leafs");
+    // leafs found before the move still work and know their prefix through the new root
+    ASSERT(leafs.front().Prefix() == Chars("ab"), "Leaf broken by the move");
+    b.Erase(leafs.front());
+    ASSERT(b.Size() == 4, "Erase through an old leaf did not update the moved tree");
+
+    a.Insert(Chars("xyz"), 7);
+    Tree c;
+    c.Insert(Chars("dropped"), 0);
+    c = std::move(b);
+    ASSERT(c.Size() == 4 && c.FindAll(Chars("dropped")).empty(), "Move assignment kept old leafs");
+    ASSERT(c.FindAll(Chars("abc")).size() == 1 && c.FindAll(Chars("abc")).front().Prefix() == Chars("abc"),
+           "Move assignment lost leafs");
+    c = std::move(a);
+    ASSERT(c.Size() == 1 && c.FindAll().front().Data() == 7, "Second move assignment");
+    ASSERT(a.Empty() && b.Empty(), "Moved-from trees not empty");
+}
+
+/**
+ * Exact lookups and erasures by key only match leafs, not their prefixes or extensions
+ */
+void TestFindErase() {
+    Tree tree;
+    tree.Insert(Chars("abc"), 1);
+    tree.Insert(Chars("abcde"), 2);
+    tree.Insert(Chars(""), 3);
+    ASSERT(tree.Find(Chars("abc")) && *tree.Find(Chars("abc")) == 1, "Key not found");
+    ASSERT(tree.Find(Chars("")) && *tree.Find(Chars("")) == 3, "Empty key not found");
+    ASSERT(!tree.Find(Chars("ab")) && !tree.Find(Chars("abcd")) && !tree.Find(Chars("abcdef")), "Non-leaf found");
+
+    ASSERT(!tree.Erase(Chars("abcd")) && tree.Size() == 3, "Non-leaf erased");
+    ASSERT(tree.Erase(Chars("abc")) && tree.Size() == 2, "Leaf not erased");
+    ASSERT(!tree.Find(Chars("abc")) && *tree.Find(Chars("abcde")) == 2, "Erase touched another leaf");
+    ASSERT(!tree.Erase(Chars("abc")), "Leaf erased twice");
+    ASSERT(tree.Erase(Chars("abcde")) && tree.Size() == 1, "Last leaf below not erased");
+    // the nodes of an erased key remain, but hold no leaf
+    ASSERT(!tree.Find(Chars("abcde")) && tree.FindAll(Chars("a")).empty(), "Emptied path still found");
+    ASSERT(tree.Insert(Chars("abc"), 4) && *tree.Find(Chars("abc")) == 4, "Reinsert after erase");
+}
+
+size_t EditDistance(const std::string &a, const std::string &b) {
+    std::vector<size_t> prev(b.size() + 1), row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) prev[j] = j;
+    for (size_t i = 1; i <= a.size(); ++i) {
+        row[0] = i;
+        for (size_t j = 1; j <= b.size(); ++j)
+            row[j] = std::min({prev[j] + 1, row[j - 1] + 1, prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1)});
+        prev.swap(row);
+    }
+    return prev[b.size()];
+}
+
+/**
+ * FindWithin against edit distances to every word: same leafs, closest first with ties in key order,
+ * and with max_results the first that many of them
+ */
+void TestFindWithin() {
+    std::mt19937 gen{11};
+    auto random_word = [&gen](size_t max_length) {
+        std::string word(gen() % (max_length + 1), 'a');
+        for (auto &c : word) c = static_cast<char>('a' + gen() % 4);
+        return word;
+    };
+    std::set<std::string> words{""};
+    while (words.size() < 2000) words.insert(random_word(7));
+    Tree tree;
+    for (const auto &word : words) tree.Insert(Chars(word), word.size());
+    // erased leafs must not be found, while their nodes stay in the tree
+    for (const auto &word : {"ab", "abca", "dddd"})
+        if (tree.Erase(Chars(word))) words.erase(word);
+
+    for (size_t q = 0; q < 300; ++q) {
+        const auto query = random_word(9);
+        for (size_t k = 0; k <= 3; ++k) {
+            std::vector<std::pair<size_t, std::string>> expected;
+            for (const auto &word : words) {
+                const auto distance = EditDistance(query, word);
+                if (distance <= k) expected.emplace_back(distance, word);
+            }
+            std::sort(expected.begin(), expected.end());
+            for (size_t max_results : {SIZE_MAX, size_t{0}, size_t{1}, size_t{3}, size_t{10}}) {
+                const auto found = tree.FindWithin(Chars(query), k, max_results);
+                const auto size = std::min(max_results, expected.size());
+                const auto context = "'" + query + "' within " + std::to_string(k) + " at most " +
+                                     std::to_string(max_results);
+                ASSERT(found.size() == size, "Wrong number of leafs for " + context);
+                for (size_t idx = 0; idx < size; ++idx) {
+                    const auto &leaf = found[idx];
+                    ASSERT(leaf.second == expected[idx].first && leaf.first.Prefix() == Chars(expected[idx].second),
+                           "Wrong leaf for " + context);
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    TestDeepChain();
+    TestMove();
+    TestFindErase();
+    TestFindWithin();
+    std::cout << "OK" << std::endl;
+    return 0;
+}
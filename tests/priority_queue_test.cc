@@ -0,0 +1,60 @@
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+#include "hara/PriorityQueue.h"
+#include "hara/Macros.h"
+
+using Entries = std::vector<std::pair<int, int>>;
+
+/**
+ * A key whose value goes back to an earlier one must still appear once in TopN
+ */
+void TestTopNRevertedValue() {
+    const Entries inserts{{1, 5}, {2, 1}, {3, 100}, {1, 7}, {1, 5}};
+    const Entries expected{{3, 100}, {1, 5}, {2, 1}};
+    hara::PriorityQueue1<int, int> queue1;
+    hara::PriorityQueue2<int, int> queue2;
+    hara::PriorityQueue3<int, int> queue3;
+    for (const auto &pair : inserts) {
+        queue1.InsertOrUpdate(pair);
+        queue2.InsertOrUpdate(pair);
+        queue3.InsertOrUpdate(pair);
+    }
+    ASSERT(queue1.TopN(3) == expected, "Impl1 TopN after a reverted value");
+    ASSERT(queue2.TopN(3) == expected, "Impl2 TopN after a reverted value");
+    ASSERT(queue3.TopN(3) == expected, "Impl3 TopN after a reverted value");
+}
+
+/**
+ * Random updates over few keys and values, so that values often return to earlier ones
+ */
+void TestTopNRandom() {
+    std::mt19937 gen{7};
+    hara::PriorityQueue1<int, int> queue1;
+    hara::PriorityQueue2<int, int> queue2;
+    hara::PriorityQueue3<int, int> queue3;
+    for (size_t op = 0; op < 20000; ++op) {
+        const int key = static_cast<int>(gen() % 50), value = static_cast<int>(gen() % 20);
+        if (gen() % 10 == 0) {
+            queue1.Erase(key);
+            queue2.Erase(key);
+            queue3.Erase(key);
+        } else {
+            queue1.InsertOrUpdate({key, value});
+            queue2.InsertOrUpdate({key, value});
+            queue3.InsertOrUpdate({key, value});
+        }
+        const size_t n = gen() % 12;
+        const auto expected = queue2.TopN(n);
+        ASSERT(queue1.TopN(n) == expected, "Impl1 TopN differs at operation " + std::to_string(op));
+        ASSERT(queue3.TopN(n) == expected, "Impl3 TopN differs at operation " + std::to_string(op));
+    }
+}
+
+int main() {
+    TestTopNRevertedValue();
+    TestTopNRandom();
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "hara/Input.h"
+#include "hara/RecordReader.h"
+#include "hara/Macros.h"
+
+using Records = std::vector<std::vector<std::string>>;
+
+const std::string path = "/tmp/hara_record_reader_test_" + std::to_string(getpid()) + ".csv";
+
+void WriteFile(const std::string &content) {
+    std::ofstream ofs{path, std::ios::binary};
+    ofs.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+/**
+ * Projected fields of every record, with "<none>" for columns past the end of a record
+ */
+Records Read(const std::string &content, const std::vector<size_t> &columns,
+             hara::RecordReader::Options options = hara::RecordReader::Csv()) {
+    WriteFile(content);
+    hara::Input input{path};
+    hara::RecordReader reader{input, columns, options};
+    Records records;
+    while (reader.Next()) {
+        records.emplace_back();
+        for (size_t idx = 0; idx < reader.NumColumns(); ++idx)
+            records.back().push_back(reader.Has(idx) ? reader.Field(idx).ToString() : "<none>");
+    }
+    ASSERT(reader.NumRecords() == records.size(), "Wrong number of records");
+    return records;
+}
+
+/**
+ * Whether reading the content throws a runtime_error
+ */
+bool Throws(const std::string &content, const std::vector<size_t> &columns) {
+    try {
+        Read(content, columns);
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+void TestUnquoted() {
+    ASSERT((Read("a\tb\tc\nd\te\tf\n", {2, 0}, hara::RecordReader::Tsv()) == Records{{"c", "a"}, {"f", "d"}}),
+           "Wrong TSV projection");
+    ASSERT((Read("a\tb\nc\n\n", {1, 0}, hara::RecordReader::Tsv()) ==
+            Records{{"b", "a"}, {"<none>", "c"}, {"<none>", ""}}), "Wrong short records");
+    // quotes are plain characters unless quoting is enabled
+    ASSERT((Read("\"a\tb\"\tc\n", {1}, hara::RecordReader::Tsv()) == Records{{"b\""}}), "Quote in TSV");
+}
+
+void TestEmbeddedDelimiters() {
+    ASSERT((Read("\"a,b\",c\n", {0, 1}) == Records{{"a,b", "c"}}), "Wrong quoted delimiter");
+    ASSERT((Read("\"\",x,\",\"\n", {0, 1, 2}) == Records{{"", "x", ","}}), "Wrong empty or delimiter-only field");
+    ASSERT((Read("x,\"a,b\"\n", {1}) == Records{{"a,b"}}), "Wrong quoted last field");
+}
+
+void TestDoubledQuotes() {
+    ASSERT((Read("\"say \"\"hi\"\"\",b\n", {0, 1}) == Records{{"say \"hi\"", "b"}}), "Wrong doubled quotes");
+    ASSERT((Read("\"\"\"\"\n", {0}) == Records{{"\""}}), "Wrong lone escaped quote");
+    // two unescaped fields of one record both live in scratch
+    ASSERT((Read("\"a\"\"\",\"\"\"b\"\n\"c\",d\n", {1, 0}) == Records{{"\"b", "a\""}, {"d", "c"}}),
+           "Wrong fields unescaped in one record");
+}
+
+void TestQuotedNewlines() {
+    ASSERT((Read("\"line 1\nline 2\",b\nc,d\n", {0, 1}) == Records{{"line 1\nline 2", "b"}, {"c", "d"}}),
+           "Wrong quoted newline");
+    ASSERT((Read("\"a\n\n\"\"b\"\"\n\",c\n", {0, 1}) == Records{{"a\n\n\"b\"\n", "c"}}),
+           "Wrong quoted blank lines and escapes");
+    // the field after a multi-line one is found on the continuation line
+    ASSERT((Read("\"x\ny\",z\n", {1}) == Records{{"z"}}), "Wrong field after a quoted newline");
+}
+
+void TestCrlf() {
+    ASSERT((Read("a,\"b\"\r\nc,d\r\n", {0, 1}) == Records{{"a", "b"}, {"c", "d"}}), "Wrong CRLF records");
+    // line breaks inside quotes are kept as they are
+    ASSERT((Read("\"x\r\ny\nz\",w\r\n", {0, 1}) == Records{{"x\r\ny\nz", "w"}}), "Wrong quoted CRLF");
+    ASSERT((Read("a,\"b\r\n\"\r\nc\r\n", {0}) == Records{{"a"}, {"c"}}), "Wrong unprojected quoted CRLF");
+    // outside of quoted mode the CR stays in the field
+    ASSERT((Read("a\tb\r\n", {1}, hara::RecordReader::Tsv()) == Records{{"b\r"}}), "CR dropped from TSV");
+}
+
+void TestProjectionPastQuoted() {
+    // quoted fields before the projection are skipped, quoted fields after it still end the record correctly
+    ASSERT((Read("\"a,\"\"b\",c,d\n", {2}) == Records{{"d"}}), "Wrong field after a skipped quoted field");
+    ASSERT((Read("a,\"x\ny,z\"\nb,w\n", {0}) == Records{{"a"}, {"b"}}), "Unprojected quoted newline split a record");
+    ASSERT((Read("a,b,\"q\"\"\n\",\"r\ns\"\nc\n", {0}) == Records{{"a"}, {"c"}}),
+           "Unprojected quoted fields split a record");
+    ASSERT((Read("a,\"b,c\"\nd\n", {2}) == Records{{"<none>"}, {"<none>"}}), "Quoted delimiter counted as a column");
+}
+
+void TestHeader() {
+    WriteFile("id,\"first, last\",\"note\"\"s\"\n1,\"Doe, John\",\"multi\nline\"\n");
+    hara::Input input{path};
+    hara::RecordReader reader{input, std::vector<std::string>{"note\"s", "first, last"}, hara::RecordReader::Csv()};
+    ASSERT((reader.Header() == std::vector<std::string>{"id", "first, last", "note\"s"}), "Wrong header");
+    ASSERT(reader.Next(), "Missing record");
+    ASSERT(reader.Field(0).ToString() == "multi\nline" && reader.Field(1).ToString() == "Doe, John",
+           "Wrong fields by name");
+    ASSERT(!reader.Next(), "Unexpected record");
+}
+
+void TestMalformed() {
+    ASSERT(Throws("\"abc\n", {0}), "Unterminated quote accepted");
+    ASSERT(Throws("a,\"b\nc\nd", {1}), "Unterminated multi-line quote accepted");
+    // an unterminated quote past the projection still has to find the end of the record
+    ASSERT(Throws("a,\"b\n", {0}), "Unterminated unprojected quote accepted");
+    ASSERT(Throws("\"a\"b,c\n", {0}), "Text after a closing quote accepted");
+    ASSERT(Throws("\"a\" ,c\n", {1}), "Space after a closing quote accepted");
+
+    bool thrown = false;
+    try {
+        Read("ok\n\"bad\n", {0});
+    } catch (const std::runtime_error &e) {
+        thrown = std::string{e.what()}.find("record 2") != std::string::npos;
+    }
+    ASSERT(thrown, "Expected the record number in the error");
+}
+
+int main() {
+    TestUnquoted();
+    TestEmbeddedDelimiters();
+    TestDoubledQuotes();
+    TestQuotedNewlines();
+    TestCrlf();
+    TestProjectionPastQuoted();
+    TestHeader();
+    TestMalformed();
+    std::remove(path.c_str());
+    printf("OK\n");
+    return 0;
+}
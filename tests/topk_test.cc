@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "hara/TopK.h"
+#include "hara/Macros.h"
+
+using Pairs = std::vector<std::pair<int, int>>;
+
+/**
+ * Brute-force top k of the latest values, ties broken by key like TopK
+ */
+Pairs Reference(const std::map<int, int> &values, size_t k) {
+    Pairs sorted{values.begin(), values.end()};
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<int, int> &a, const std::pair<int, int> &b) {
+        return a.second > b.second || (a.second == b.second && a.first > b.first);
+    });
+    if (sorted.size() > k) sorted.resize(k);
+    return sorted;
+}
+
+/**
+ * Counts only grow, so the result stays exact
+ */
+void TestIncreasing() {
+    std::mt19937 gen{1};
+    hara::TopK<int, int> top{10};
+    std::map<int, int> values;
+    for (size_t op = 0; op < 20000; ++op) {
+        const auto key = static_cast<int>(gen() % 200);
+        const auto value = ++values[key];
+        top.InsertOrUpdate({key, value});
+        ASSERT(top.Exact(), "Increasing stream reported inexact");
+        ASSERT(top.Sorted() == Reference(values, 10), "Increasing stream differs at " + std::to_string(op));
+    }
+}
+
+/**
+ * A resident key dropping below a forgotten one is evicted and the result flagged inexact
+ */
+void TestDecreaseBelowForgotten() {
+    hara::TopK<int, int> top{2};
+    top.InsertOrUpdate({1, 10});
+    top.InsertOrUpdate({2, 20});
+    ASSERT(!top.InsertOrUpdate({3, 5}), "Non-competitive key admitted");
+    ASSERT(top.Exact(), "Inexact before any decrease");
+    ASSERT(top.InsertOrUpdate({2, 8}), "Decrease above the forgotten key evicted it");
+    ASSERT(top.Exact(), "Inexact after a harmless decrease");
+    ASSERT(!top.InsertOrUpdate({1, 1}), "Key decreased below a forgotten one stays resident");
+    ASSERT(!top.Contain(1) && !top.Exact(), "Decrease below a forgotten key not reported");
+}
+
+/**
+ * Random increasing and decreasing updates: exact results match the reference,
+ * and resident pairs always carry their latest value
+ */
+void TestDecreasing() {
+    std::mt19937 gen{2};
+    for (size_t trial = 0; trial < 200; ++trial) {
+        hara::TopK<int, int> top{5};
+        std::map<int, int> values;
+        for (size_t op = 0; op < 200; ++op) {
+            const auto key = static_cast<int>(gen() % 30);
+            auto &value = values[key];
+            // mostly increases, sometimes a drop
+            value += gen() % 5 == 0 ? -static_cast<int>(gen() % 10) : static_cast<int>(gen() % 4);
+            top.InsertOrUpdate({key, value});
+            for (const auto &pair : top.Sorted())
+                ASSERT(values.at(pair.first) == pair.second, "Resident pair with a stale value");
+            if (top.Exact())
+                ASSERT(top.Sorted() == Reference(values, 5),
+                       "Exact result differs in trial " + std::to_string(trial) + " at " + std::to_string(op));
+        }
+    }
+}
+
+/**
+ * Key and value types without default constructors
+ */
+struct Word {
+    explicit Word(std::string text) : text{std::move(text)} {}
+
+    bool operator<(const Word &that) const { return text < that.text; }
+
+    bool operator==(const Word &that) const { return text == that.text; }
+
+    std::string text;
+};
+
+namespace std {
+template<>
+struct hash<Word> {
+    size_t operator()(const Word &word) const { return hash<string>{}(word.text); }
+};
+}
+
+struct Count {
+    explicit Count(int n) : n{n} {}
+
+    bool operator<(const Count &that) const { return n < that.n; }
+
+    int n;
+};
+
+void TestNoDefaultConstructor() {
+    hara::TopK<Word, Count> top{2};
+    top.InsertOrUpdate({Word{"a"}, Count{3}});
+    top.InsertOrUpdate({Word{"b"}, Count{5}});
+    ASSERT(!top.InsertOrUpdate({Word{"c"}, Count{2}}), "Non-competitive key admitted");
+    ASSERT(!top.InsertOrUpdate({Word{"a"}, Count{1}}), "Key decreased below a forgotten one stays resident");
+    ASSERT(!top.Exact() && top.Size() == 1 && top.Peek(Word{"b"}).n == 5, "Wrong pairs");
+    top.Clear();
+    ASSERT(top.Empty() && top.Exact(), "Clear kept state");
+}
+
+int main() {
+    TestIncreasing();
+    TestDecreaseBelowForgotten();
+    TestDecreasing();
+    TestNoDefaultConstructor();
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "hara/Output.h"
+#include "hara/WordCount.h"
+#include "hara/Macros.h"
+
+/**
+ * Lines of random tokens, some of them long enough to take an arena block of their own
+ */
+std::map<std::string, uint64_t> WriteTokens(const std::string &path) {
+    std::mt19937 gen{5};
+    std::map<std::string, uint64_t> counts;
+    hara::Output output{path};
+    for (size_t line = 0; line < 50000; ++line) {
+        const auto num_tokens = gen() % 8;
+        for (size_t t = 0; t < num_tokens; ++t) {
+            auto token = "w" + std::to_string(gen() % 1000);
+            if (gen() % 10000 == 0) token.append(size_t{1} << 17u, 'x');
+            ++counts[token];
+            output << token << (gen() % 2 ? " " : "\t ");
+        }
+        output << '\n';
+    }
+    output.Close();
+    return counts;
+}
+
+void TestCounts(const std::string &path, const std::map<std::string, uint64_t> &expected, size_t num_threads) {
+    hara::WordCount counter{num_threads, 100};
+    hara::Input input{path};
+    counter.Add(input);
+    const auto &table = counter.Table();
+    ASSERT(table.Size() == expected.size(), "Wrong number of tokens with " + std::to_string(num_threads) + " threads");
+    for (const auto &entry : expected)
+        ASSERT(table.Count(entry.first) == entry.second, "Wrong count of " + entry.first.substr(0, 10));
+}
+
+/**
+ * A read error in the middle of the input reaches the caller instead of terminating the process
+ */
+void TestReadError(const std::string &path, size_t num_threads) {
+    bool failed = false;
+    try {
+        hara::WordCount counter{num_threads, 100};
+        hara::Input input{path};
+        counter.Add(input);
+    } catch (const std::runtime_error &) {
+        failed = true;
+    }
+    ASSERT(failed, "A truncated input was counted with " + std::to_string(num_threads) + " threads");
+}
+
+int main() {
+    const std::string tmp = "/tmp/hara_word_count_test_" + std::to_string(getpid());
+    const auto expected = WriteTokens(tmp + ".txt");
+    for (size_t num_threads : {1, 2, 4}) TestCounts(tmp + ".txt", expected, num_threads);
+    std::remove((tmp + ".txt").c_str());
+
+#ifdef HARA_ZLIB
+    const auto gz = tmp + ".txt.gz", truncated = tmp + "_truncated.gz";
+    WriteTokens(gz);
+    {
+        std::ifstream ifs{gz, std::ios::binary};
+        const std::string content{std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{}};
+        std::ofstream ofs{truncated, std::ios::binary};
+        ofs.write(content.data(), static_cast<std::streamsize>(content.size() / 2));
+    }
+    for (size_t num_threads : {1, 2, 4}) TestReadError(truncated, num_threads);
+    std::remove(gz.c_str());
+    std::remove(truncated.c_str());
+#endif
+    std::cout << "OK" << std::endl;
+    return 0;
+}